@@ -114,6 +114,8 @@ CloudContext::CloudContext(QObject* parent)
       thumbnailer_thread_pool_(IThreadPool::create(2)),
       pool_(std::make_shared<RequestPool>()),
       cache_size_(updatedCacheSize()),
+      thumbnail_cache_size_(std::max(
+          QSettings().value("thumbnailCacheSize", 32).toInt(), 1)),
       interrupt_(std::make_shared<std::atomic_bool>()) {
   {
     std::unique_lock<std::mutex> lock(gMutex);
@@ -273,6 +275,16 @@ void CloudContext::setPlayerBackend(const QString& str) {
   emit playerBackendChanged();
 }
 
+int CloudContext::thumbnailCacheSize() const { return thumbnail_cache_size_; }
+
+void CloudContext::setThumbnailCacheSize(int size) {
+  size = std::max(size, 1);
+  QSettings settings;
+  settings.setValue("thumbnailCacheSize", size);
+  thumbnail_cache_size_ = size;
+  emit thumbnailCacheSizeChanged();
+}
+
 QString CloudContext::authorizationUrl(const QString& provider) const {
   return this->provider(provider.toStdString(), Token{})
       ->authorizeLibraryUrl()
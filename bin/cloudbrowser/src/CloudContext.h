@@ -57,6 +57,8 @@ class CloudContext : public QObject {
   Q_PROPERTY(qint64 cacheSize READ cacheSize NOTIFY cacheSizeChanged)
   Q_PROPERTY(QString playerBackend READ playerBackend WRITE setPlayerBackend
                  NOTIFY playerBackendChanged)
+  Q_PROPERTY(int thumbnailCacheSize READ thumbnailCacheSize WRITE
+                 setThumbnailCacheSize NOTIFY thumbnailCacheSizeChanged)
   Q_PROPERTY(bool httpServerAvailable READ httpServerAvailable CONSTANT)
 
   class RequestPool {
@@ -94,6 +96,9 @@ class CloudContext : public QObject {
 
   void setPlayerBackend(const QString&);
 
+  int thumbnailCacheSize() const;
+  void setThumbnailCacheSize(int);
+
   Q_INVOKABLE QString authorizationUrl(const QString& provider) const;
   Q_INVOKABLE QObject* root(const QVariant& provider);
   Q_INVOKABLE void removeProvider(const QVariant& label);
@@ -128,6 +133,7 @@ class CloudContext : public QObject {
                      QString description);
   void cacheSizeChanged();
   void playerBackendChanged();
+  void thumbnailCacheSizeChanged();
 
  private:
   class HttpServerCallback : public cloudstorage::IHttpServer::ICallback {
@@ -163,6 +169,7 @@ class CloudContext : public QObject {
                      std::vector<cloudstorage::IItem::Pointer>>
       list_directory_cache_;
   qint64 cache_size_;
+  std::atomic_int thumbnail_cache_size_;
   ProviderListModel user_provider_model_;
   std::shared_ptr<std::atomic_bool> interrupt_;
   mutable int provider_index_ = 0;
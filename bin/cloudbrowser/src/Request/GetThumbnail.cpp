@@ -261,7 +261,11 @@ class Generator : public QQuickImageResponse {
           auto provider_id = std::stoi(json["state"].asString());
           auto provider = gCloudContext->userProviders()->provider(provider_id);
           auto size = json["size"].asInt();
+          auto cache_size = static_cast<size_t>(
+              gCloudContext->thumbnailCacheSize());
           lock.unlock();
+          if (response_->item_cache_->capacity() != cache_size)
+            response_->item_cache_->set_capacity(cache_size);
           auto item = response_->item_cache_->get(std::to_string(provider_id) +
                                                   "#" + item_id);
           if (!item) {
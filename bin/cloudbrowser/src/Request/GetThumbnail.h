@@ -40,6 +40,7 @@ class ThumbnailGenerator : public QQuickAsyncImageProvider {
       const QString& id, const QSize& requested_size) override;
 
  private:
+  // Resized to CloudContext::thumbnailCacheSize on every request.
   std::shared_ptr<
       cloudstorage::util::LRUCache<std::string, cloudstorage::IItem>>
       item_cache_ = std::make_shared<
@@ -88,7 +88,9 @@ void FileSystem::Node::set_upload_request(std::shared_ptr<IGenericRequest> r) {
 
 FileSystem::FileSystem(const std::vector<ProviderEntry>& provider,
                        IHttp::Pointer http, std::string temporary_directory)
-    : next_(1),
+    : read_cache_(READ_CACHE_SIZE,
+                  [](const Block& block) { return block.size(); }),
+      next_(1),
       running_(true),
       http_(std::move(http)),
       temporary_directory_(std::move(temporary_directory)),
@@ -436,67 +438,95 @@ void FileSystem::read(FileId node, size_t offset, size_t sz,
       auto d = data.substr(start, size);
       return cb(d);
     }
-    auto fit = [=](Range r) {
-      r.start_ =
-          std::min<size_t>(r.start_, static_cast<size_t>(nd->size() - 1));
-      r.size_ =
-          std::min<size_t>(r.size_, static_cast<size_t>(nd->size() - r.start_));
-      return r;
-    };
-    Range range = fit({offset, sz});
+    if (offset >= nd->size()) return cb(std::string());
+    Range range = {offset, std::min<uint64_t>(sz, nd->size() - offset)};
     std::unique_lock<mutex> lock(nd->mutex_);
-    auto inside = [=](Range r1, Range r2) {
-      r1 = fit(r1);
-      r2 = fit(r2);
-      return r1.start_ >= r2.start_ &&
-             r1.start_ + r1.size_ <= r2.start_ + r2.size_;
-    };
-    auto download = [=](Range range) {
-      for (auto&& download_range : nd->pending_download_)
-        if (inside(range, download_range)) return;
-      range = fit({range.start_, std::max<size_t>(range.size_, READ_AHEAD)});
-      nd->pending_download_.push_back(range);
-      download_item_async(
-          nd->provider(), nd->item(), range, [=](EitherError<std::string> e) {
-            std::unique_lock<mutex> lock(nd->mutex_);
-            auto requests = nd->read_request_;
-            for (auto&& read : requests)
-              if (inside(read.range_, range)) {
-                if (e.left())
-                  read.callback_(e.left());
-                else
-                  read.callback_(e.right()->substr(
-                      read.range_.start_ - range.start_, read.range_.size_));
-                auto it = std::find(nd->read_request_.begin(),
-                                    nd->read_request_.end(), read);
-                if (it != nd->read_request_.end()) nd->read_request_.erase(it);
-              }
-            auto it = std::find(nd->pending_download_.begin(),
-                                nd->pending_download_.end(), range);
-            if (it != nd->pending_download_.end())
-              nd->pending_download_.erase(it);
-            if (e.right()) {
-              nd->chunk_.push_back({range, std::move(*e.right())});
-              if (nd->chunk_.size() >= CACHED_CHUNK_COUNT)
-                nd->chunk_.pop_front();
-            }
-          });
-    };
-    bool read_ahead = true;
-    for (auto&& chunk : nd->chunk_)
-      if (inside(Range{range.start_ + READ_AHEAD / 2, READ_AHEAD / 2},
-                 chunk.range_))
-        read_ahead = false;
-    if (read_ahead) download(Range{range.start_ + READ_AHEAD / 2, range.size_});
-    for (auto&& chunk : nd->chunk_)
-      if (inside(range, chunk.range_))
-        return cb(chunk.data_.substr(range.start_ - chunk.range_.start_,
-                                     range.size_));
-    nd->read_request_.push_back({range, cb});
-    download(range);
+    nd->read_request_.push_back({nd->next_read_request_++, range, cb});
+    complete_reads(nd, 0, nullptr);
+    auto last = range.start_ + range.size_ - 1;
+    fetch(nd, last - last % BLOCK_SIZE + BLOCK_SIZE);
   });
 }
 
+std::string FileSystem::block_key(const Node& nd, uint64_t offset) const {
+  // Nodes are replaced, keeping the inode, when the file changes remotely.
+  return std::to_string(nd.inode()) + ":" + std::to_string(nd.size()) + ":" +
+         std::to_string(nd.timestamp().time_since_epoch().count()) + ":" +
+         std::to_string(offset);
+}
+
+void FileSystem::fetch(const Node::Pointer& nd, uint64_t offset) {
+  if (offset >= nd->size() || read_cache_.get(block_key(*nd, offset)) ||
+      std::find(nd->pending_download_.begin(), nd->pending_download_.end(),
+                offset) != nd->pending_download_.end())
+    return;
+  nd->pending_download_.push_back(offset);
+  download_item_async(
+      nd->provider(), nd->item(),
+      Range{offset, std::min<uint64_t>(BLOCK_SIZE, nd->size() - offset)},
+      [=](EitherError<std::string> e) {
+        std::unique_lock<mutex> lock(nd->mutex_);
+        auto it = std::find(nd->pending_download_.begin(),
+                            nd->pending_download_.end(), offset);
+        if (it != nd->pending_download_.end()) nd->pending_download_.erase(it);
+        if (e.left()) {
+          auto requests = nd->read_request_;
+          for (auto&& read : requests)
+            if (read.range_.start_ < offset + BLOCK_SIZE &&
+                read.range_.start_ + read.range_.size_ > offset) {
+              nd->read_request_.erase(std::find(nd->read_request_.begin(),
+                                                nd->read_request_.end(), read));
+              read.callback_(e.left());
+            }
+          return;
+        }
+        auto block = std::make_shared<Block>(std::move(*e.right()));
+        read_cache_.put(block_key(*nd, offset), block);
+        complete_reads(nd, offset, block);
+      });
+}
+
+// Answers read requests whose blocks are all available, fetching the missing
+// ones otherwise; the block just downloaded is passed along in case it's
+// already evicted from the cache.
+void FileSystem::complete_reads(const Node::Pointer& nd, uint64_t offset,
+                                const std::shared_ptr<Block>& downloaded) {
+  auto requests = nd->read_request_;
+  for (auto&& read : requests) {
+    auto it =
+        std::find(nd->read_request_.begin(), nd->read_request_.end(), read);
+    if (it == nd->read_request_.end()) continue;
+    auto end = read.range_.start_ + read.range_.size_;
+    std::vector<std::shared_ptr<Block>> blocks;
+    std::vector<uint64_t> missing;
+    for (auto start = read.range_.start_ - read.range_.start_ % BLOCK_SIZE;
+         start < end; start += BLOCK_SIZE) {
+      auto block = downloaded && start == offset
+                       ? downloaded
+                       : read_cache_.get(block_key(*nd, start));
+      if (!block) missing.push_back(start);
+      blocks.push_back(block);
+    }
+    if (!missing.empty()) {
+      for (auto start : missing) fetch(nd, start);
+      continue;
+    }
+    std::string data;
+    data.reserve(read.range_.size_);
+    auto position = read.range_.start_;
+    for (const auto& block : blocks) {
+      auto from = position % BLOCK_SIZE;
+      auto length = std::min<uint64_t>(end - position, BLOCK_SIZE - from);
+      if (from + length > block->size())
+        length = from < block->size() ? block->size() - from : 0;
+      data.append(block->data() + from, length);
+      position += length;
+    }
+    nd->read_request_.erase(it);
+    read.callback_(std::move(data));
+  }
+}
+
 void FileSystem::invalidate(FileId root) {
   std::lock_guard<mutex> lock(node_data_mutex_);
   auto it = node_directory_.find(root);
@@ -713,7 +743,7 @@ void FileSystem::download_item_async(const std::shared_ptr<ICloudProvider>& p,
         : start_(std::chrono::system_clock::now()), callback_(cb) {}
 
     void receivedData(const char* data, uint32_t length) override {
-      buffer_ += std::string(data, length);
+      buffer_.append(data, length);
     }
 
     void done(EitherError<void> e) override {
@@ -18,8 +18,10 @@
 
 namespace cloudstorage {
 
-const int READ_AHEAD = 2 * 1024 * 1024;
-const int CACHED_CHUNK_COUNT = 4;
+// Reads are served from blocks of file data aligned to BLOCK_SIZE, kept in a
+// cache shared by all files up to READ_CACHE_SIZE bytes.
+const uint64_t BLOCK_SIZE = 2 * 1024 * 1024;
+const size_t READ_CACHE_SIZE = 128 * 1024 * 1024;
 const auto CACHE_DIRECTORY_DURATION = std::chrono::seconds(60);
 
 class FileSystem : public IFileSystem {
@@ -50,16 +52,12 @@ class FileSystem : public IFileSystem {
    private:
     friend class FileSystem;
 
-    struct Chunk {
-      Range range_;
-      std::string data_;
-    };
-
     struct ReadRequest {
+      uint64_t id_;
       Range range_;
       DownloadItemCallback callback_;
 
-      bool operator==(const ReadRequest &r) const { return range_ == r.range_; }
+      bool operator==(const ReadRequest &r) const { return id_ == r.id_; }
     };
 
     mutex mutex_;
@@ -70,8 +68,8 @@ class FileSystem : public IFileSystem {
     uint64_t size_;
     std::shared_ptr<IGenericRequest> upload_request_;
     std::vector<ReadRequest> read_request_;
-    std::vector<Range> pending_download_;
-    std::deque<Chunk> chunk_;
+    uint64_t next_read_request_ = 0;
+    std::vector<uint64_t> pending_download_;
     std::string cache_filename_;
     std::string path_;
     std::unique_ptr<std::fstream> store_;
@@ -119,6 +117,13 @@ class FileSystem : public IFileSystem {
   void cancelled();
   void cancel(std::shared_ptr<IGenericRequest>);
 
+  using Block = std::string;
+
+  std::string block_key(const Node &, uint64_t offset) const;
+  void fetch(const Node::Pointer &, uint64_t offset);
+  void complete_reads(const Node::Pointer &, uint64_t offset,
+                      const std::shared_ptr<Block> &);
+
   void list_directory_async(const std::shared_ptr<ICloudProvider> &,
                             const IItem::Pointer &,
                             const cloudstorage::ListDirectoryCallback &);
@@ -141,6 +146,7 @@ class FileSystem : public IFileSystem {
   std::unordered_map<FileId, std::chrono::system_clock::time_point>
       node_timestamp_;
   std::unordered_map<std::string, FileId> auth_node_;
+  util::LRUCache<std::string, Block> read_cache_;
   FileId next_;
   std::deque<RequestData> request_data_;
   std::deque<std::shared_ptr<IGenericRequest>> cancelled_request_;
@@ -27,8 +27,11 @@
 #include <tinyxml2.h>
 #include <algorithm>
 #include <iomanip>
+#include <unordered_set>
 
-#include "Request/RecursiveRequest.h"
+#include "Request/Request.h"
+#include "Request/UploadFileRequest.h"
+#include "Request/WorkQueue.h"
 #include "Utility/Utility.h"
 
 using namespace std::placeholders;
@@ -72,9 +75,155 @@ std::string currentDateAndTime() {
   return ss.str();
 }
 
+std::string escapeXml(const std::string& str) {
+  std::string result;
+  for (char c : str)
+    switch (c) {
+      case '&':
+        result += "&amp;";
+        break;
+      case '<':
+        result += "&lt;";
+        break;
+      case '>':
+        result += "&gt;";
+        break;
+      default:
+        result += c;
+    }
+  return result;
+}
+
+std::string childText(std::istream& stream, const char* name) {
+  std::stringstream sstream;
+  sstream << stream.rdbuf();
+  tinyxml2::XMLDocument document;
+  if (document.Parse(sstream.str().c_str()) != tinyxml2::XML_SUCCESS)
+    return "";
+  auto element = document.RootElement()->FirstChildElement(name);
+  return element && element->GetText() ? element->GetText() : "";
+}
+
+// CopyObject and CompleteMultipartUpload may report errors with status 200
+EitherError<void> checkResult(std::istream& stream) {
+  std::stringstream sstream;
+  sstream << stream.rdbuf();
+  tinyxml2::XMLDocument document;
+  if (sstream.str().empty() ||
+      document.Parse(sstream.str().c_str()) != tinyxml2::XML_SUCCESS)
+    return nullptr;
+  auto root = document.RootElement();
+  auto error = std::string(root->Name()) == "Error"
+                   ? root
+                   : root->FirstChildElement("Error");
+  if (!error) return nullptr;
+  std::string message;
+  for (auto name : {"Code", "Key", "Message"})
+    if (auto element = error->FirstChildElement(name))
+      if (element->GetText())
+        message += (message.empty() ? "" : " ") +
+                   std::string(element->GetText());
+  return Error{IHttpRequest::Failure, message};
+}
+
+struct MultipartUpload {
+  MultipartUpload(IUploadFileCallback::Pointer callback, uint64_t size,
+                  uint64_t part_size, size_t part_count)
+      : callback_(std::move(callback)),
+        size_(size),
+        part_size_(part_size),
+        sent_(part_count),
+        etags_(part_count) {}
+
+  // putData may not be reentrant, e.g. it seeks a shared stream
+  uint32_t putData(char* data, uint32_t maxlength, uint64_t offset) {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    return callback_->putData(data, maxlength, offset);
+  }
+
+  void progress(size_t index, uint64_t now) {
+    std::lock_guard<std::mutex> lock(progress_mutex_);
+    sent_[index] = now;
+    uint64_t total = 0;
+    for (auto d : sent_) total += d;
+    callback_->progress(size_, total);
+  }
+
+  IUploadFileCallback::Pointer callback_;
+  uint64_t size_;
+  uint64_t part_size_;
+  std::mutex data_mutex_;
+  std::mutex progress_mutex_;
+  std::vector<uint64_t> sent_;
+  std::vector<std::string> etags_;
+};
+
+const int PART_RETRY_COUNT = 3;
+
+// Only transient failures are worth sending a part again; client errors like
+// 403 or 404 would fail the same way.
+bool retryable(int code) {
+  return code < 0 || code / 100 == 5 || code == IHttpRequest::Unknown;
+}
+
+void uploadPart(const Request<EitherError<IItem>>::Pointer& r,
+                const std::string& url, const std::string& upload_id,
+                const std::shared_ptr<MultipartUpload>& upload, size_t index,
+                int retries, const WorkQueue::Completion& complete) {
+  auto offset = index * upload->part_size_;
+  auto length = std::min(upload->part_size_, upload->size_ - offset);
+  auto stream = std::make_shared<UploadStreamWrapper>(
+      [=](char* data, uint32_t maxlength, uint64_t position) {
+        return upload->putData(data, maxlength, offset + position);
+      },
+      length);
+  r->send(
+      [=](util::Output) {
+        stream->reset();
+        auto request = r->provider()->http()->create(url, "PUT");
+        request->setParameter("partNumber", std::to_string(index + 1));
+        request->setParameter("uploadId", upload_id);
+        return request;
+      },
+      [=](EitherError<Response> e) {
+        if (e.left()) {
+          if (retries > 0 && retryable(e.left()->code_) && !r->is_cancelled())
+            return uploadPart(r, url, upload_id, upload, index, retries - 1,
+                              complete);
+          return complete(e.left());
+        }
+        auto it = e.right()->headers().find("etag");
+        if (it == e.right()->headers().end())
+          return complete(Error{IHttpRequest::Failure,
+                                util::Error::UNKNOWN_RESPONSE_RECEIVED});
+        upload->etags_[index] = it->second;
+        complete(nullptr);
+      },
+      [=] { return std::make_shared<std::iostream>(stream.get()); },
+      std::make_shared<std::stringstream>(), nullptr,
+      [=](uint64_t, uint64_t now) { upload->progress(index, now); }, true);
+}
+
+const size_t COPY_CONCURRENCY = 16;
+const size_t PART_COPY_CONCURRENCY = 4;
+const size_t DELETE_CONCURRENCY = 4;
+const size_t DELETE_BATCH_SIZE = 1000;
+const uint64_t MAX_COPY_OBJECT_SIZE = 5ull << 30;
+const uint64_t COPY_PART_SIZE = 1ull << 30;
+const uint64_t MAX_PART_COUNT = 10000;
+const uint64_t MIN_UPLOAD_PART_SIZE = 5 * 1024 * 1024;
+const uint64_t MAX_UPLOAD_PART_SIZE = 5ull << 30;
+const uint64_t DEFAULT_UPLOAD_PART_SIZE = 16 * 1024 * 1024;
+const size_t MAX_UPLOAD_CONCURRENCY = 16;
+
 }  // namespace
 
-AmazonS3::AmazonS3() : CloudProvider(util::make_unique<Auth>()) {}
+AmazonS3::AmazonS3()
+    : CloudProvider(util::make_unique<Auth>()),
+      upload_part_size_(DEFAULT_UPLOAD_PART_SIZE),
+      upload_concurrency_(std::min<size_t>(
+          std::max(std::thread::hardware_concurrency(), 4u),
+          MAX_UPLOAD_CONCURRENCY)) {}
 
 void AmazonS3::initialize(InitData&& init_data) {
   if (init_data.token_.empty())
@@ -86,6 +235,18 @@ void AmazonS3::initialize(InitData&& init_data) {
                 [&](const std::string& v) { rewritten_endpoint_ = v; });
     setWithHint(init_data.hints_, "region",
                 [&](const std::string& v) { region_ = v; });
+    setWithHint(init_data.hints_, "upload_part_size",
+                [&](const std::string& v) {
+                  upload_part_size_ = std::min(
+                      std::max<uint64_t>(std::strtoull(v.c_str(), nullptr, 10),
+                                         MIN_UPLOAD_PART_SIZE),
+                      MAX_UPLOAD_PART_SIZE);
+                });
+    setWithHint(init_data.hints_, "upload_concurrency",
+                [&](const std::string& v) {
+                  upload_concurrency_ = std::max<size_t>(
+                      std::strtoul(v.c_str(), nullptr, 10), 1);
+                });
   }
   CloudProvider::initialize(std::move(init_data));
 }
@@ -119,7 +280,10 @@ ICloudProvider::Hints AmazonS3::hints() const {
   auto hints = CloudProvider::hints();
   auto lock = auth_lock();
   hints.insert(
-      {{"rewritten_endpoint", rewritten_endpoint_}, {"region", region_}});
+      {{"rewritten_endpoint", rewritten_endpoint_},
+       {"region", region_},
+       {"upload_part_size", std::to_string(upload_part_size_)},
+       {"upload_concurrency", std::to_string(upload_concurrency_)}});
   return hints;
 }
 
@@ -171,78 +335,160 @@ AuthorizeRequest::Pointer AmazonS3::authorizeAsync() {
   return std::make_shared<AuthorizeRequest>(shared_from_this(), auth);
 }
 
-ICloudProvider::MoveItemRequest::Pointer AmazonS3::moveItemAsync(
-    IItem::Pointer source, IItem::Pointer destination,
-    MoveItemCallback callback) {
-  using Request = RecursiveRequest<EitherError<IItem>>;
-  auto visitor = [=](Request::Pointer r, IItem::Pointer item,
-                     Request::CompleteCallback callback) {
-    auto l = getPath("/" + source->id()).length();
-    std::string new_path = destination->id() + item->id().substr(l);
+ICloudProvider::UploadFileRequest::Pointer AmazonS3::uploadFileAsync(
+    IItem::Pointer parent, const std::string& filename,
+    IUploadFileCallback::Pointer callback) {
+  auto size = callback->size();
+  auto part_size =
+      std::min(std::max(upload_part_size(),
+                        (size + MAX_PART_COUNT - 1) / MAX_PART_COUNT),
+               MAX_UPLOAD_PART_SIZE);
+  if (size <= part_size)
+    return CloudProvider::uploadFileAsync(parent, filename, callback);
+  auto part_count = (size + part_size - 1) / part_size;
+  // data of a source which isn't seekable can be read only once, in order
+  auto seekable = callback->seekable();
+  auto concurrency = seekable ? upload_concurrency() : 1;
+  auto retries = seekable ? PART_RETRY_COUNT : 0;
+  auto resolver = [=](Request<EitherError<IItem>>::Pointer r) {
+    auto url = endpoint() + "/" + escapePath(parent->id() + filename);
     r->request(
         [=](util::Output) {
-          auto request = http()->create(endpoint() + "/" + new_path, "PUT");
-          if (item->type() != IItem::FileType::Directory)
-            request->setHeaderParameter(
-                "x-amz-copy-source", bucket() + "/" + escapePath(item->id()));
+          auto request = http()->create(url, "POST");
+          request->setParameter("uploads", "");
           return request;
         },
         [=](EitherError<Response> e) {
-          if (e.left()) return callback(e.left());
-          r->request(
-              [=](util::Output) {
-                return http()->create(endpoint() + "/" + escapePath(item->id()),
-                                      "DELETE");
+          if (e.left()) return r->done(e.left());
+          auto upload_id = childText(e.right()->output(), "UploadId");
+          if (upload_id.empty())
+            return r->done(
+                Error{IHttpRequest::Failure, util::Error::INVALID_XML});
+          auto abort = [=](const Error& error) {
+            r->request(
+                [=](util::Output) {
+                  auto request = http()->create(url, "DELETE");
+                  request->setParameter("uploadId", upload_id);
+                  return request;
+                },
+                [=](EitherError<Response>) { r->done(error); });
+          };
+          auto upload = std::make_shared<MultipartUpload>(
+              callback, size, part_size, part_count);
+          WorkQueue::for_each(
+              part_count, concurrency,
+              [=](size_t index, WorkQueue::Completion complete) {
+                uploadPart(r, url, upload_id, upload, index, retries, complete);
               },
-              [=](EitherError<Response> e) {
-                if (e.left()) return callback(e.left());
-                IItem::Pointer renamed = std::make_shared<Item>(
-                    getFilename(new_path), new_path, item->size(),
-                    item->timestamp(), item->type());
-                callback(renamed);
+              [=](EitherError<void> e) {
+                if (e.left()) return abort(*e.left());
+                r->request(
+                    [=](util::Output input) {
+                      auto request = http()->create(url, "POST");
+                      request->setParameter("uploadId", upload_id);
+                      request->setHeaderParameter("Content-Type",
+                                                  "application/xml");
+                      *input << "<CompleteMultipartUpload>";
+                      for (size_t i = 0; i < upload->etags_.size(); i++)
+                        *input << "<Part><PartNumber>" << i + 1
+                               << "</PartNumber><ETag>"
+                               << escapeXml(upload->etags_[i])
+                               << "</ETag></Part>";
+                      *input << "</CompleteMultipartUpload>";
+                      return request;
+                    },
+                    [=](EitherError<Response> e) {
+                      if (e.left()) return abort(*e.left());
+                      auto result = checkResult(e.right()->output());
+                      if (result.left()) return abort(*result.left());
+                      r->done(uploadFileResponse(*parent, filename, size,
+                                                 e.right()->output()));
+                    });
               });
         });
   };
-  return std::make_shared<Request>(shared_from_this(), source, callback,
-                                   visitor)
+  return std::make_shared<Request<EitherError<IItem>>>(
+             shared_from_this(),
+             [=](EitherError<IItem> e) { callback->done(e); }, resolver)
       ->run();
 }
 
+ICloudProvider::MoveItemRequest::Pointer AmazonS3::moveItemAsync(
+    IItem::Pointer source, IItem::Pointer destination,
+    MoveItemCallback callback) {
+  auto l = getPath("/" + source->id()).length();
+  auto prefix = destination->id();
+  return transferItemAsync(
+      source, [=](const std::string& id) { return prefix + id.substr(l); },
+      callback);
+}
+
 ICloudProvider::RenameItemRequest::Pointer AmazonS3::renameItemAsync(
     IItem::Pointer root, const std::string& name, RenameItemCallback callback) {
-  using Request = RecursiveRequest<EitherError<IItem>>;
   auto new_prefix = (getPath("/" + root->id()) + "/" + name).substr(1);
-  auto visitor = [=](Request::Pointer r, IItem::Pointer item,
-                     Request::CompleteCallback callback) {
-    auto new_path = new_prefix + "/" + item->id().substr(root->id().length());
-    if (!new_path.empty() && new_path.back() == '/' &&
-        item->type() != IItem::FileType::Directory)
-      new_path.pop_back();
-    r->request(
-        [=](util::Output) {
-          auto request = http()->create(endpoint() + "/" + new_path, "PUT");
-          if (item->type() != IItem::FileType::Directory)
-            request->setHeaderParameter(
-                "x-amz-copy-source", bucket() + "/" + escapePath(item->id()));
-          return request;
-        },
-        [=](EitherError<Response> e) {
-          if (e.left()) return callback(e.left());
-          r->request(
-              [=](util::Output) {
-                return http()->create(endpoint() + "/" + escapePath(item->id()),
-                                      "DELETE");
+  auto root_id = root->id();
+  auto is_directory = root->type() == IItem::FileType::Directory;
+  return transferItemAsync(root,
+                           [=](const std::string& id) {
+                             auto new_path = new_prefix + "/" +
+                                             id.substr(root_id.length());
+                             if (!is_directory && !new_path.empty() &&
+                                 new_path.back() == '/')
+                               new_path.pop_back();
+                             return new_path;
+                           },
+                           callback);
+}
+
+ICloudProvider::MoveItemRequest::Pointer AmazonS3::transferItemAsync(
+    IItem::Pointer item, std::function<std::string(const std::string&)> path,
+    MoveItemCallback callback) {
+  auto resolver = [=](Request<EitherError<IItem>>::Pointer r) {
+    auto new_path = path(item->id());
+    auto finish = [=](EitherError<void> e) {
+      if (e.left()) return r->done(e.left());
+      IItem::Pointer moved =
+          std::make_shared<Item>(getFilename(new_path), new_path, item->size(),
+                                 item->timestamp(), item->type());
+      r->done(moved);
+    };
+    if (item->type() != IItem::FileType::Directory) {
+      return copyObject(r, item, new_path, [=](EitherError<void> e) {
+        if (e.left()) return r->done(e.left());
+        r->request(
+            [=](util::Output) {
+              return http()->create(endpoint() + "/" + escapePath(item->id()),
+                                    "DELETE");
+            },
+            [=](EitherError<Response> e) {
+              if (e.left()) return r->done(e.left());
+              finish(nullptr);
+            });
+      });
+    }
+    listObjects(
+        r, item, "", std::make_shared<IItem::List>(),
+        [=](EitherError<IItem::List> e) {
+          if (e.left()) return r->done(e.left());
+          auto objects = std::make_shared<IItem::List>(*e.right());
+          objects->push_back(item);
+          WorkQueue::for_each(
+              objects->size(), COPY_CONCURRENCY,
+              [=](size_t index, WorkQueue::Completion complete) {
+                auto object = (*objects)[index];
+                copyObject(r, object, path(object->id()), complete);
               },
-              [=](EitherError<Response> e) {
-                if (e.left()) return callback(e.left());
-                IItem::Pointer renamed = std::make_shared<Item>(
-                    getFilename(new_path), new_path, item->size(),
-                    item->timestamp(), item->type());
-                callback(renamed);
+              [=](EitherError<void> e) {
+                if (e.left()) return r->done(e.left());
+                auto keys = std::make_shared<std::vector<std::string>>();
+                for (const auto& object : *objects)
+                  keys->push_back(object->id());
+                deleteObjects(r, keys, finish);
               });
         });
   };
-  return std::make_shared<Request>(shared_from_this(), root, callback, visitor)
+  return std::make_shared<Request<EitherError<IItem>>>(shared_from_this(),
+                                                       callback, resolver)
       ->run();
 }
 
@@ -263,22 +509,32 @@ IItem::Pointer AmazonS3::createDirectoryResponse(const IItem& parent,
 
 ICloudProvider::DeleteItemRequest::Pointer AmazonS3::deleteItemAsync(
     IItem::Pointer item, DeleteItemCallback callback) {
-  using Request = RecursiveRequest<EitherError<void>>;
-  auto visitor = [=](Request::Pointer r, IItem::Pointer item,
-                     Request::CompleteCallback complete) {
-    r->request(
-        [=](util::Output) {
-          return http()->create(endpoint() + "/" + escapePath(item->id()),
-                                "DELETE");
-        },
-        [=](EitherError<Response> e) {
-          if (e.left())
-            complete(e.left());
-          else
-            complete(nullptr);
-        });
+  auto resolver = [=](Request<EitherError<void>>::Pointer r) {
+    if (item->type() != IItem::FileType::Directory)
+      return r->request(
+          [=](util::Output) {
+            return http()->create(endpoint() + "/" + escapePath(item->id()),
+                                  "DELETE");
+          },
+          [=](EitherError<Response> e) {
+            if (e.left())
+              r->done(e.left());
+            else
+              r->done(nullptr);
+          });
+    listObjects(r, item, "", std::make_shared<IItem::List>(),
+                [=](EitherError<IItem::List> e) {
+                  if (e.left()) return r->done(e.left());
+                  auto keys = std::make_shared<std::vector<std::string>>();
+                  for (const auto& object : *e.right())
+                    keys->push_back(object->id());
+                  if (!item->id().empty()) keys->push_back(item->id());
+                  deleteObjects(r, keys,
+                                [=](EitherError<void> e) { r->done(e); });
+                });
   };
-  return std::make_shared<Request>(shared_from_this(), item, callback, visitor)
+  return std::make_shared<Request<EitherError<void>>>(shared_from_this(),
+                                                      callback, resolver)
       ->run();
 }
 
@@ -437,6 +693,244 @@ IItem::List AmazonS3::listDirectoryResponse(
   return result;
 }
 
+template <class T>
+void AmazonS3::listObjects(
+    std::shared_ptr<Request<T>> r, IItem::Pointer root,
+    const std::string& page_token, std::shared_ptr<IItem::List> result,
+    std::function<void(EitherError<IItem::List>)> complete) const {
+  r->request(
+      [=](util::Output input) {
+        return walkTreeRequest(*root, page_token, *input);
+      },
+      [=](EitherError<Response> e) {
+        if (e.left()) return complete(e.left());
+        std::string next_page_token;
+        try {
+          for (auto&& d : walkTreeResponse(*root, e.right()->output(),
+                                           next_page_token))
+            result->push_back(d.second);
+        } catch (const std::exception& e) {
+          return complete(Error{IHttpRequest::Failure, e.what()});
+        }
+        if (!next_page_token.empty())
+          return listObjects(r, root, next_page_token, result, complete);
+        std::unordered_set<std::string> ids;
+        IItem::List objects;
+        for (const auto& d : *result)
+          if (ids.insert(d->id()).second) objects.push_back(d);
+        complete(objects);
+      });
+}
+
+template <class T>
+void AmazonS3::copyObject(
+    std::shared_ptr<Request<T>> r, IItem::Pointer item,
+    const std::string& destination,
+    std::function<void(EitherError<void>)> complete) const {
+  if (item->type() != IItem::FileType::Directory &&
+      item->size() != IItem::UnknownSize &&
+      item->size() > MAX_COPY_OBJECT_SIZE)
+    return copyObjectMultipart(r, item, destination, complete);
+  r->request(
+      [=](util::Output) {
+        auto request =
+            http()->create(endpoint() + "/" + escapePath(destination), "PUT");
+        if (item->type() != IItem::FileType::Directory)
+          request->setHeaderParameter(
+              "x-amz-copy-source", bucket() + "/" + escapePath(item->id()));
+        return request;
+      },
+      [=](EitherError<Response> e) {
+        if (e.left()) return complete(e.left());
+        complete(checkResult(e.right()->output()));
+      });
+}
+
+template <class T>
+void AmazonS3::copyObjectMultipart(
+    std::shared_ptr<Request<T>> r, IItem::Pointer item,
+    const std::string& destination,
+    std::function<void(EitherError<void>)> complete) const {
+  auto url = endpoint() + "/" + escapePath(destination);
+  r->request(
+      [=](util::Output) {
+        auto request = http()->create(url, "POST");
+        request->setParameter("uploads", "");
+        return request;
+      },
+      [=](EitherError<Response> e) {
+        if (e.left()) return complete(e.left());
+        auto upload_id = childText(e.right()->output(), "UploadId");
+        if (upload_id.empty())
+          return complete(
+              Error{IHttpRequest::Failure, util::Error::INVALID_XML});
+        auto abort = [=](const Error& error) {
+          r->request(
+              [=](util::Output) {
+                auto request = http()->create(url, "DELETE");
+                request->setParameter("uploadId", upload_id);
+                return request;
+              },
+              [=](EitherError<Response>) { complete(error); });
+        };
+        auto part_size =
+            std::max(COPY_PART_SIZE,
+                     (item->size() + MAX_PART_COUNT - 1) / MAX_PART_COUNT);
+        auto part_count = (item->size() + part_size - 1) / part_size;
+        auto etags = std::make_shared<std::vector<std::string>>(part_count);
+        auto complete_upload = [=](EitherError<void> e) {
+          if (e.left()) return abort(*e.left());
+          r->request(
+              [=](util::Output input) {
+                auto request = http()->create(url, "POST");
+                request->setParameter("uploadId", upload_id);
+                request->setHeaderParameter("Content-Type", "application/xml");
+                *input << "<CompleteMultipartUpload>";
+                for (size_t i = 0; i < etags->size(); i++)
+                  *input << "<Part><PartNumber>" << i + 1
+                         << "</PartNumber><ETag>" << escapeXml((*etags)[i])
+                         << "</ETag></Part>";
+                *input << "</CompleteMultipartUpload>";
+                return request;
+              },
+              [=](EitherError<Response> e) {
+                if (e.left()) return abort(*e.left());
+                auto result = checkResult(e.right()->output());
+                if (result.left()) return abort(*result.left());
+                complete(nullptr);
+              });
+        };
+        WorkQueue::for_each(
+            part_count, PART_COPY_CONCURRENCY,
+            [=](size_t index, WorkQueue::Completion done) {
+              r->request(
+                  [=](util::Output) {
+                    auto begin = index * part_size;
+                    auto end = std::min(begin + part_size, item->size()) - 1;
+                    auto request = http()->create(url, "PUT");
+                    request->setParameter("partNumber",
+                                          std::to_string(index + 1));
+                    request->setParameter("uploadId", upload_id);
+                    request->setHeaderParameter(
+                        "x-amz-copy-source",
+                        bucket() + "/" + escapePath(item->id()));
+                    request->setHeaderParameter(
+                        "x-amz-copy-source-range",
+                        "bytes=" + std::to_string(begin) + "-" +
+                            std::to_string(end));
+                    return request;
+                  },
+                  [=](EitherError<Response> e) {
+                    if (e.left()) return done(e.left());
+                    auto etag = childText(e.right()->output(), "ETag");
+                    if (etag.empty())
+                      return done(Error{IHttpRequest::Failure,
+                                        util::Error::INVALID_XML});
+                    (*etags)[index] = etag;
+                    done(nullptr);
+                  });
+            },
+            complete_upload);
+      });
+}
+
+template <class T>
+void AmazonS3::deleteObjects(
+    std::shared_ptr<Request<T>> r,
+    std::shared_ptr<std::vector<std::string>> keys,
+    std::function<void(EitherError<void>)> complete) const {
+  auto batch_count = (keys->size() + DELETE_BATCH_SIZE - 1) / DELETE_BATCH_SIZE;
+  WorkQueue::for_each(
+      batch_count, DELETE_CONCURRENCY,
+      [=](size_t index, WorkQueue::Completion done) {
+        std::string body = "<Delete><Quiet>true</Quiet>";
+        for (size_t i = index * DELETE_BATCH_SIZE;
+             i < std::min(keys->size(), (index + 1) * DELETE_BATCH_SIZE); i++)
+          body += "<Object><Key>" + escapeXml((*keys)[i]) + "</Key></Object>";
+        body += "</Delete>";
+        r->request(
+            [=](util::Output input) {
+              auto request = http()->create(endpoint() + "/", "POST");
+              request->setParameter("delete", "");
+              request->setHeaderParameter("Content-Type", "application/xml");
+              request->setHeaderParameter("x-amz-sdk-checksum-algorithm",
+                                          "SHA256");
+              request->setHeaderParameter(
+                  "x-amz-checksum-sha256",
+                  util::to_base64(crypto()->sha256(body)));
+              *input << body;
+              return request;
+            },
+            [=](EitherError<Response> e) {
+              if (e.left()) return done(e.left());
+              done(checkResult(e.right()->output()));
+            });
+      },
+      complete);
+}
+
+IHttpRequest::Pointer AmazonS3::walkTreeRequest(const IItem& item,
+                                                const std::string& page_token,
+                                                std::ostream&) const {
+  auto request = http()->create(endpoint() + "/", "GET");
+  request->setParameter("list-type", "2");
+  request->setParameter("prefix", item.id());
+  if (!page_token.empty())
+    request->setParameter("continuation-token", page_token);
+  return request;
+}
+
+CloudProvider::TreeEntries AmazonS3::walkTreeResponse(
+    const IItem& root, std::istream& stream,
+    std::string& next_page_token) const {
+  std::stringstream sstream;
+  sstream << stream.rdbuf();
+  tinyxml2::XMLDocument document;
+  if (document.Parse(sstream.str().c_str()) != tinyxml2::XML_SUCCESS)
+    throw std::logic_error(util::Error::FAILED_TO_PARSE_XML);
+  TreeEntries result;
+  auto add_directory = [&](const std::string& id) {
+    auto path = id.substr(root.id().length());
+    path.pop_back();
+    result.push_back({path, util::make_unique<Item>(
+                                getFilename(id), id, IItem::UnknownSize,
+                                IItem::UnknownTimeStamp,
+                                IItem::FileType::Directory)});
+  };
+  for (auto child = document.RootElement()->FirstChildElement("Contents");
+       child; child = child->NextSiblingElement("Contents")) {
+    auto key_element = child->FirstChildElement("Key");
+    auto size_element = child->FirstChildElement("Size");
+    auto timestamp_element = child->FirstChildElement("LastModified");
+    if (!key_element || !size_element || !timestamp_element)
+      throw std::logic_error(util::Error::INVALID_XML);
+    std::string id = key_element->GetText();
+    if (id.length() <= root.id().length()) continue;
+    // keys don't need directory markers, so every prefix is reported; the
+    // request skips directories it has already seen
+    for (auto it = id.find('/', root.id().length()); it != std::string::npos;
+         it = id.find('/', it + 1))
+      add_directory(id.substr(0, it + 1));
+    if (id.back() == '/') continue;
+    auto item = util::make_unique<Item>(
+        getFilename(id), id, std::stoull(size_element->GetText()),
+        util::parse_time(timestamp_element->GetText()),
+        IItem::FileType::Unknown);
+    item->set_url(getUrl(*item));
+    result.push_back({id.substr(root.id().length()), std::move(item)});
+  }
+  auto is_truncated_element =
+      document.RootElement()->FirstChildElement("IsTruncated");
+  if (!is_truncated_element) throw std::logic_error(util::Error::INVALID_XML);
+  if (is_truncated_element->GetText() == std::string("true")) {
+    auto next_token_element =
+        document.RootElement()->FirstChildElement("NextContinuationToken");
+    if (!next_token_element) throw std::logic_error(util::Error::INVALID_XML);
+    next_page_token = next_token_element->GetText();
+  }
+  return result;
+}
+
 void AmazonS3::authorizeRequest(IHttpRequest& request) const {
   if (!crypto()) throw std::runtime_error("no crypto functions provided");
   std::string region = this->region().empty() ? "us-east-1" : this->region();
@@ -524,6 +1018,16 @@ bool AmazonS3::isSuccess(int code,
          CloudProvider::isSuccess(code, headers);
 }
 
+uint64_t AmazonS3::upload_part_size() const {
+  auto lock = auth_lock();
+  return upload_part_size_;
+}
+
+size_t AmazonS3::upload_concurrency() const {
+  auto lock = auth_lock();
+  return upload_concurrency_;
+}
+
 std::string AmazonS3::access_id() const {
   auto lock = auth_lock();
   return access_id_;
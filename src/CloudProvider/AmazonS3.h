@@ -33,10 +33,13 @@ namespace cloudstorage {
 /**
  * AmazonS3 requires computing HMAC-SHA256 hashes, so it requires a valid
  * ICrypto implementation. Be careful about renaming and moving directories,
- * because there has to be an http request per each of its subelement. Buckets
+ * because each of its subelements has to be copied; copies are made in
+ * parallel and sources are removed with batched DeleteObjects calls. Buckets
  * are listed as root directory's children, renaming and moving them doesn't
  * work. Token in this case is a base64 encoded json with fields
- * username (access_id), password (secret_key), region.
+ * username (access_id), password (secret_key), region. Files larger than
+ * upload_part_size (hint, 16 MiB by default, at most 5 GiB) are uploaded with
+ * multipart upload, sending up to upload_concurrency (hint) parts at once.
  */
 class AmazonS3 : public CloudProvider {
  public:
@@ -51,6 +54,9 @@ class AmazonS3 : public CloudProvider {
   Hints hints() const override;
 
   AuthorizeRequest::Pointer authorizeAsync() override;
+  UploadFileRequest::Pointer uploadFileAsync(
+      IItem::Pointer, const std::string& filename,
+      IUploadFileCallback::Pointer) override;
   GetItemDataRequest::Pointer getItemDataAsync(const std::string& id,
                                                GetItemDataCallback f) override;
   MoveItemRequest::Pointer moveItemAsync(IItem::Pointer source,
@@ -74,9 +80,14 @@ class AmazonS3 : public CloudProvider {
       std::ostream& prefix_stream, std::ostream& suffix_stream) const override;
   IHttpRequest::Pointer downloadFileRequest(
       const IItem&, std::ostream& input_stream) const override;
+  IHttpRequest::Pointer walkTreeRequest(const IItem&,
+                                        const std::string& page_token,
+                                        std::ostream&) const override;
 
   IItem::List listDirectoryResponse(
       const IItem&, std::istream&, std::string& next_page_token) const override;
+  TreeEntries walkTreeResponse(const IItem&, std::istream&,
+                               std::string& next_page_token) const override;
   IItem::Pointer createDirectoryResponse(const IItem& parent,
                                          const std::string& name,
                                          std::istream& response) const override;
@@ -94,6 +105,8 @@ class AmazonS3 : public CloudProvider {
   std::string region() const;
   std::string bucket() const;
   std::string s3_endpoint() const;
+  uint64_t upload_part_size() const;
+  size_t upload_concurrency() const;
 
   class Auth : public cloudstorage::Auth {
    public:
@@ -112,6 +125,26 @@ class AmazonS3 : public CloudProvider {
  private:
   bool unpackCredentials(const std::string&) override;
   std::string getUrl(const Item&) const;
+  ICloudProvider::MoveItemRequest::Pointer transferItemAsync(
+      IItem::Pointer item, std::function<std::string(const std::string&)>,
+      MoveItemCallback);
+  template <class T>
+  void listObjects(std::shared_ptr<Request<T>>, IItem::Pointer root,
+                   const std::string& page_token,
+                   std::shared_ptr<IItem::List> result,
+                   std::function<void(EitherError<IItem::List>)>) const;
+  template <class T>
+  void copyObject(std::shared_ptr<Request<T>>, IItem::Pointer item,
+                  const std::string& destination,
+                  std::function<void(EitherError<void>)>) const;
+  template <class T>
+  void copyObjectMultipart(std::shared_ptr<Request<T>>, IItem::Pointer item,
+                           const std::string& destination,
+                           std::function<void(EitherError<void>)>) const;
+  template <class T>
+  void deleteObjects(std::shared_ptr<Request<T>>,
+                     std::shared_ptr<std::vector<std::string>> keys,
+                     std::function<void(EitherError<void>)>) const;
   void getRegion(const AuthorizeRequest::Pointer& r,
                  const AuthorizeRequest::AuthorizeCompleted& complete);
   void getEndpoint(const AuthorizeRequest::Pointer& r,
@@ -123,6 +156,8 @@ class AmazonS3 : public CloudProvider {
   std::string bucket_;
   std::string s3_endpoint_;
   std::string rewritten_endpoint_;
+  uint64_t upload_part_size_;
+  size_t upload_concurrency_;
 };
 
 }  // namespace cloudstorage
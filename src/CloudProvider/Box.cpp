@@ -45,6 +45,8 @@ IItem::Pointer Box::rootDirectory() const {
 
 std::string Box::name() const { return "box"; }
 
+IItem::HashType Box::hashType() const { return IItem::HashType::SHA1; }
+
 std::string Box::endpoint() const { return BOXAPI_ENDPOINT; }
 
 bool Box::reauthorize(int code, const IHttpRequest::HeaderParameters&) const {
@@ -81,7 +83,7 @@ IHttpRequest::Pointer Box::listDirectoryRequest(const IItem& item,
                                                 std::ostream&) const {
   auto request = http()->create(
       endpoint() + "/2.0/folders/" + FileId(item.id()).id_ + "/items/", "GET");
-  request->setParameter("fields", "name,id,size,modified_at");
+  request->setParameter("fields", "name,id,size,modified_at,sha1");
   if (!page_token.empty()) request->setParameter("offset", page_token);
   return request;
 }
@@ -178,6 +180,24 @@ IHttpRequest::Pointer Box::moveItemRequest(const IItem& source,
   return request;
 }
 
+IHttpRequest::Pointer Box::copyItemRequest(const IItem& source,
+                                           const IItem& destination,
+                                           std::ostream& stream) const {
+  IHttpRequest::Pointer request;
+  auto data = FileId(source.id());
+  if (source.type() == IItem::FileType::Directory)
+    request = http()->create(
+        endpoint() + "/2.0/folders/" + data.id_ + "/copy", "POST");
+  else
+    request =
+        http()->create(endpoint() + "/2.0/files/" + data.id_ + "/copy", "POST");
+  request->setHeaderParameter("Content-Type", "application/json");
+  Json::Value json;
+  json["parent"]["id"] = FileId(destination.id()).id_;
+  stream << json;
+  return request;
+}
+
 IHttpRequest::Pointer Box::renameItemRequest(const IItem& item,
                                              const std::string& name,
                                              std::ostream& input) const {
@@ -197,6 +217,15 @@ IHttpRequest::Pointer Box::getGeneralDataRequest(std::ostream&) const {
   return http()->create(endpoint() + "/2.0/users/me");
 }
 
+IHttpRequest::Pointer Box::listChangesRequest(const IItem&,
+                                              const std::string& cursor,
+                                              std::ostream&) const {
+  auto request = http()->create(endpoint() + "/2.0/events", "GET");
+  request->setParameter("stream_type", "changes");
+  request->setParameter("stream_position", cursor.empty() ? "now" : cursor);
+  return request;
+}
+
 IItem::Pointer Box::getItemDataResponse(std::istream& stream) const {
   return toItem(util::json::from_stream(stream));
 }
@@ -214,6 +243,25 @@ IItem::List Box::listDirectoryResponse(const IItem&, std::istream& stream,
   return result;
 }
 
+ChangeData Box::listChangesResponse(const IItem&, std::istream& stream,
+                                    bool& has_more) const {
+  auto response = util::json::from_stream(stream);
+  ChangeData result;
+  for (const Json::Value& v : response["entries"]) {
+    const auto& source = v["source"];
+    auto type = source["type"].asString();
+    if (type != "file" && type != "folder") continue;
+    if (v["event_type"].asString() == "ITEM_TRASH")
+      result.deleted_.push_back(
+          FileId(type == "folder", source["id"].asString()));
+    else
+      result.items_.push_back(toItem(source));
+  }
+  result.cursor_ = response["next_stream_position"].asString();
+  has_more = response["chunk_size"].asInt() > 0;
+  return result;
+}
+
 IItem::Pointer Box::toItem(const Json::Value& v) const {
   IItem::FileType type = IItem::FileType::Unknown;
   if (v["type"].asString() == "folder") type = IItem::FileType::Directory;
@@ -222,6 +270,8 @@ IItem::Pointer Box::toItem(const Json::Value& v) const {
       FileId(type == IItem::FileType::Directory, v["id"].asString()),
       v["size"].asUInt64(), util::parse_time(v["modified_at"].asString()),
       type);
+  if (v.isMember("sha1"))
+    item->set_hash(IItem::HashType::SHA1, v["sha1"].asString());
   return std::move(item);
 }
 
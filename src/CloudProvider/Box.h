@@ -36,6 +36,7 @@ class Box : public CloudProvider {
 
   IItem::Pointer rootDirectory() const override;
   std::string name() const override;
+  IItem::HashType hashType() const override;
   std::string endpoint() const override;
   bool reauthorize(int, const IHttpRequest::HeaderParameters&) const override;
 
@@ -61,9 +62,14 @@ class Box : public CloudProvider {
                                                std::ostream&) const override;
   IHttpRequest::Pointer moveItemRequest(const IItem&, const IItem&,
                                         std::ostream&) const override;
+  IHttpRequest::Pointer copyItemRequest(const IItem&, const IItem&,
+                                        std::ostream&) const override;
   IHttpRequest::Pointer renameItemRequest(const IItem&, const std::string& name,
                                           std::ostream&) const override;
   IHttpRequest::Pointer getGeneralDataRequest(std::ostream&) const override;
+  IHttpRequest::Pointer listChangesRequest(const IItem&,
+                                           const std::string& cursor,
+                                           std::ostream&) const override;
 
   IItem::Pointer getItemDataResponse(std::istream& response) const override;
   IItem::List listDirectoryResponse(
@@ -75,6 +81,8 @@ class Box : public CloudProvider {
                                     const std::string& filename, uint64_t,
                                     std::istream& response) const override;
   GeneralData getGeneralDataResponse(std::istream& response) const override;
+  ChangeData listChangesResponse(const IItem&, std::istream&,
+                                 bool& has_more) const override;
 
   IItem::Pointer toItem(const Json::Value&) const;
 
@@ -29,10 +29,13 @@
 #include <fstream>
 #include <sstream>
 
+#include "Utility/ContentHash.h"
 #include "Utility/FileServer.h"
+#include "Utility/FileWriter.h"
 #include "Utility/Item.h"
 #include "Utility/Utility.h"
 
+#include "Request/CopyItemRequest.h"
 #include "Request/CreateDirectoryRequest.h"
 #include "Request/DeleteItemRequest.h"
 #include "Request/DownloadFileRequest.h"
@@ -40,11 +43,14 @@
 #include "Request/GetItemDataRequest.h"
 #include "Request/GetItemRequest.h"
 #include "Request/GetItemUrlRequest.h"
+#include "Request/ListChangesRequest.h"
 #include "Request/ListDirectoryPageRequest.h"
 #include "Request/ListDirectoryRequest.h"
 #include "Request/MoveItemRequest.h"
 #include "Request/RenameItemRequest.h"
+#include "Request/SegmentedDownloadRequest.h"
 #include "Request/UploadFileRequest.h"
+#include "Request/WalkTreeRequest.h"
 
 #undef CreateDirectory
 
@@ -52,6 +58,10 @@ using namespace std::placeholders;
 
 const std::string DEFAULT_STATE = "DEFAULT_STATE";
 const std::string DEFAULT_FILE_URL = "http://127.0.0.1:12346";
+const uint32_t HASH_BUFFER_SIZE = 1024 * 1024;
+const uint32_t URL_CACHE_SIZE = 1024;
+const uint32_t URL_CACHE_SHARDS = 4;
+const auto DEFAULT_URL_LIFETIME = std::chrono::minutes(10);
 
 namespace {
 
@@ -94,6 +104,51 @@ class DownloadFileCallback : public cloudstorage::IDownloadFileCallback {
   cloudstorage::DownloadFileCallback callback_;
 };
 
+class FileDownloadCallback : public cloudstorage::IDownloadFileCallback {
+ public:
+  FileDownloadCallback(std::unique_ptr<cloudstorage::FileWriter> file,
+                       bool out_of_order,
+                       const cloudstorage::DownloadFileCallback& callback)
+      : file_(std::move(file)),
+        offset_(file_->resume_offset()),
+        out_of_order_(out_of_order && !file_->direct()),
+        failed_(false),
+        callback_(callback) {}
+
+  void receivedData(const char* data, uint32_t length) override {
+    receivedDataAt(data, length, offset_);
+    offset_ += length;
+  }
+
+  bool receivesOutOfOrder() override { return out_of_order_; }
+
+  void receivedDataAt(const char* data, uint32_t length,
+                      uint64_t offset) override {
+    if (!failed_ && !file_->write(data, length, offset)) failed_ = true;
+  }
+
+  void done(cloudstorage::EitherError<void> e) override {
+    bool closed = file_->close();
+    if (e.left())
+      callback_(e);
+    else if (failed_ || !closed)
+      callback_(cloudstorage::Error{cloudstorage::IHttpRequest::Failure,
+                                    cloudstorage::util::Error::
+                                        COULD_NOT_WRITE_FILE});
+    else
+      callback_(nullptr);
+  }
+
+  void progress(uint64_t, uint64_t) override {}
+
+ private:
+  std::unique_ptr<cloudstorage::FileWriter> file_;
+  uint64_t offset_;
+  bool out_of_order_;
+  bool failed_;
+  cloudstorage::DownloadFileCallback callback_;
+};
+
 class UploadFileCallback : public cloudstorage::IUploadFileCallback {
  public:
   UploadFileCallback(const std::string& path,
@@ -125,12 +180,49 @@ class UploadFileCallback : public cloudstorage::IUploadFileCallback {
   uint64_t size_;
 };
 
+class ForwardUploadCallback : public cloudstorage::IUploadFileCallback {
+ public:
+  using Done =
+      std::function<void(cloudstorage::EitherError<cloudstorage::IItem>)>;
+
+  ForwardUploadCallback(cloudstorage::IUploadFileCallback::Pointer callback,
+                        Done done)
+      : callback_(std::move(callback)), done_(std::move(done)) {}
+
+  uint32_t putData(char* data, uint32_t maxlength, uint64_t offset) override {
+    return callback_->putData(data, maxlength, offset);
+  }
+
+  uint64_t size() override { return callback_->size(); }
+
+  void progress(uint64_t total, uint64_t now) override {
+    callback_->progress(total, now);
+  }
+
+  void uploadSession(const std::string& state) override {
+    callback_->uploadSession(state);
+  }
+
+  bool seekable() override { return callback_->seekable(); }
+
+  void done(cloudstorage::EitherError<cloudstorage::IItem> e) override {
+    done_(e);
+  }
+
+ private:
+  cloudstorage::IUploadFileCallback::Pointer callback_;
+  Done done_;
+};
+
 }  // namespace
 
 namespace cloudstorage {
 
 CloudProvider::CloudProvider(IAuth::Pointer auth)
-    : auth_(std::move(auth)), http_(), deleted_() {}
+    : auth_(std::move(auth)),
+      http_(),
+      url_cache_(URL_CACHE_SIZE, nullptr, URL_CACHE_SHARDS),
+      deleted_() {}
 
 void CloudProvider::initialize(InitData&& data) {
   auto lock = auth_lock();
@@ -139,6 +231,7 @@ void CloudProvider::initialize(InitData&& data) {
   http_ = std::move(data.http_engine_);
   http_server_ = std::move(data.http_server_);
   thread_pool_ = std::move(data.thread_pool_);
+  hash_thread_pool_ = std::move(data.hash_thread_pool_);
 
   auto t = auth()->fromTokenString(data.token_);
   setWithHint(data.hints_, "access_token",
@@ -162,6 +255,13 @@ void CloudProvider::initialize(InitData&& data) {
               [this](std::string v) { auth()->set_error_page(v); });
   setWithHint(data.hints_, "file_url",
               [this](std::string v) { file_url_ = v; });
+  FileServer::Options file_server;
+  setWithHint(data.hints_, "file_cache_size", [&](std::string v) {
+    file_server.block_cache_size_ = std::strtoull(v.c_str(), nullptr, 10);
+  });
+  setWithHint(data.hints_, "file_item_cache_size", [&](std::string v) {
+    file_server.item_cache_size_ = std::strtoull(v.c_str(), nullptr, 10);
+  });
 
 #ifdef WITH_CRYPTOPP
   if (!crypto_) crypto_ = ICrypto::create();
@@ -181,7 +281,8 @@ void CloudProvider::initialize(InitData&& data) {
   if (!http_server_)
     throw std::runtime_error("No http server module specified.");
 
-  file_daemon_ = FileServer::create(shared_from_this(), auth()->state());
+  file_daemon_ =
+      FileServer::create(shared_from_this(), auth()->state(), file_server);
   if (file_url_.empty()) file_url_ = DEFAULT_FILE_URL;
 
   if (auth()->state().empty()) auth()->set_state(DEFAULT_STATE);
@@ -201,6 +302,8 @@ void CloudProvider::destroy() {
   http_ = nullptr;
   http_server_ = nullptr;
   thread_pool_ = nullptr;
+  std::lock_guard<std::mutex> lock(hash_thread_pool_mutex_);
+  hash_thread_pool_ = nullptr;
 }
 
 std::string ICloudProvider::serializeSession(const std::string& token,
@@ -287,11 +390,29 @@ IHttpServerFactory* CloudProvider::http_server() const {
 
 IThreadPool* CloudProvider::thread_pool() const { return thread_pool_.get(); }
 
+IThreadPool* CloudProvider::hash_thread_pool() {
+  std::lock_guard<std::mutex> lock(hash_thread_pool_mutex_);
+  if (!hash_thread_pool_) hash_thread_pool_ = IThreadPool::create(1);
+  return hash_thread_pool_.get();
+}
+
 bool CloudProvider::isSuccess(int code,
                               const IHttpRequest::HeaderParameters&) const {
   return IHttpRequest::isSuccess(code);
 }
 
+IItem::HashType CloudProvider::hashType() const {
+  return IItem::HashType::None;
+}
+
+std::string CloudProvider::localFilePath(const std::string&) const {
+  return "";
+}
+
+std::chrono::seconds CloudProvider::urlLifetime() const {
+  return DEFAULT_URL_LIFETIME;
+}
+
 ICloudProvider::ExchangeCodeRequest::Pointer CloudProvider::exchangeCodeAsync(
     const std::string& code, ExchangeCodeCallback callback) {
   return std::make_shared<cloudstorage::ExchangeCodeRequest>(shared_from_this(),
@@ -317,7 +438,8 @@ ICloudProvider::DownloadFileRequest::Pointer CloudProvider::downloadFileAsync(
     IItem::Pointer file, IDownloadFileCallback::Pointer callback, Range range) {
   return std::make_shared<cloudstorage::DownloadFileRequest>(
              shared_from_this(), std::move(file), std::move(callback), range,
-             std::bind(&CloudProvider::downloadFileRequest, this, _1, _2))
+             std::bind(&CloudProvider::downloadFileRequest, this, _1, _2),
+             true)
       ->run();
 }
 
@@ -330,6 +452,96 @@ ICloudProvider::UploadFileRequest::Pointer CloudProvider::uploadFileAsync(
       ->run();
 }
 
+ICloudProvider::UploadFileRequest::Pointer CloudProvider::resumeUploadAsync(
+    const std::string&, IUploadFileCallback::Pointer callback) {
+  return std::make_shared<Request<EitherError<IItem>>>(
+             shared_from_this(),
+             [=](EitherError<IItem> e) { callback->done(e); },
+             [](Request<EitherError<IItem>>::Pointer r) {
+               r->done(
+                   Error{IHttpRequest::Failure, util::Error::UNIMPLEMENTED});
+             })
+      ->run();
+}
+
+ICloudProvider::UploadFileRequest::Pointer
+CloudProvider::uploadFileIfChangedAsync(IItem::Pointer parent,
+                                        const std::string& filename,
+                                        IUploadFileCallback::Pointer callback) {
+  using UploadMethod = UploadFileRequest::Pointer (CloudProvider::*)(
+      IItem::Pointer, const std::string&, IUploadFileCallback::Pointer);
+  auto hash_type = hashType();
+  if (hash_type == IItem::HashType::None)
+    return uploadFileAsync(parent, filename, callback);
+  auto resolver = [=](Request<EitherError<IItem>>::Pointer r) {
+    auto upload = [=] {
+      r->make_subrequest(
+          static_cast<UploadMethod>(&CloudProvider::uploadFileAsync), parent,
+          filename,
+          IUploadFileCallback::Pointer(std::make_shared<ForwardUploadCallback>(
+              callback, [=](EitherError<IItem> e) { r->done(e); })));
+    };
+    r->make_subrequest(
+        &CloudProvider::findFileAsync, parent, filename,
+        [=](EitherError<IItem> e) {
+          if (e.left()) return r->done(e.left());
+          auto remote = e.right();
+          auto size = callback->size();
+          if (!remote || remote->type() == IItem::FileType::Directory ||
+              remote->size() != size || remote->hash_type() != hash_type ||
+              remote->hash().empty())
+            return upload();
+          // Hashing large files takes a while, so it's kept off the shared
+          // thread pool.
+          hash_thread_pool()->schedule([=] {
+            auto hash = ContentHash::create(hash_type);
+            std::vector<char> buffer(HASH_BUFFER_SIZE);
+            uint64_t offset = 0;
+            while (offset < size && !r->is_cancelled()) {
+              auto length = callback->putData(
+                  buffer.data(),
+                  static_cast<uint32_t>(
+                      std::min<uint64_t>(size - offset, buffer.size())),
+                  offset);
+              if (length == 0) break;
+              hash->update(buffer.data(), length);
+              offset += length;
+            }
+            if (r->is_cancelled())
+              return r->done(
+                  Error{IHttpRequest::Aborted, util::Error::ABORTED});
+            if (offset != size ||
+                !ContentHash::matches(*remote, hash_type, hash->digest()))
+              return upload();
+            callback->progress(size, size);
+            r->done(remote);
+          });
+        });
+  };
+  return std::make_shared<Request<EitherError<IItem>>>(
+             shared_from_this(),
+             [=](EitherError<IItem> e) { callback->done(e); }, resolver)
+      ->run();
+}
+
+ICloudProvider::GetItemRequest::Pointer CloudProvider::findFileAsync(
+    IItem::Pointer directory, const std::string& filename,
+    GetItemCallback callback) {
+  auto resolver = [=](Request<EitherError<IItem>>::Pointer r) {
+    r->make_subrequest(&CloudProvider::listDirectorySimpleAsync, directory,
+                       [=](EitherError<IItem::List> e) {
+                         if (e.left()) return r->done(e.left());
+                         for (const auto& item : *e.right())
+                           if (item->filename() == filename)
+                             return r->done(item);
+                         r->done(IItem::Pointer());
+                       });
+  };
+  return std::make_shared<Request<EitherError<IItem>>>(shared_from_this(),
+                                                       callback, resolver)
+      ->run();
+}
+
 ICloudProvider::GetItemDataRequest::Pointer CloudProvider::getItemDataAsync(
     const std::string& id, GetItemDataCallback f) {
   return std::make_shared<cloudstorage::GetItemDataRequest>(shared_from_this(),
@@ -370,6 +582,12 @@ std::string CloudProvider::defaultFileDaemonUrl(const IItem& item,
   json["size"] = Json::Int64(size);
   json["state"] = auth()->state();
   json["name"] = item.filename();
+  if (!item.hash().empty()) json["hash"] = item.hash();
+  if (item.timestamp() != IItem::UnknownTimeStamp)
+    json["timestamp"] = Json::Int64(
+        std::chrono::duration_cast<std::chrono::seconds>(
+            item.timestamp().time_since_epoch())
+            .count());
   auto id = util::to_base64(util::json::to_string(json));
   std::replace(id.begin(), id.end(), '/', '-');
   return file_url() + "/" + id;
@@ -396,7 +614,7 @@ CloudProvider::makeDownloadFileRequest(
     IDownloadFileCallback::Pointer callback) {
   return std::make_shared<cloudstorage::DownloadFileRequest>(
              shared_from_this(), std::move(file), std::move(callback), range,
-             factory)
+             factory, false)
       ->run();
 }
 
@@ -425,6 +643,27 @@ std::string CloudProvider::credentialsToString(const Json::Value& json) {
   return util::to_base64(util::Url::escape(util::json::to_string(json)));
 }
 
+std::string CloudProvider::uploadSessionToString(Json::Value session,
+                                                 uint64_t offset,
+                                                 uint64_t size) const {
+  session["provider"] = name();
+  session["offset"] = Json::UInt64(offset);
+  session["size"] = Json::UInt64(size);
+  return util::json::to_string(session);
+}
+
+Json::Value CloudProvider::uploadSessionFromString(const std::string& state,
+                                                   uint64_t size) const {
+  try {
+    auto json = util::json::from_string(state);
+    if (json.isObject() && json["provider"].asString() == name() &&
+        json["size"].asUInt64() == size && json["offset"].asUInt64() <= size)
+      return json;
+  } catch (const Json::Exception&) {
+  }
+  return Json::nullValue;
+}
+
 ICloudProvider::DownloadFileRequest::Pointer CloudProvider::getThumbnailAsync(
     IItem::Pointer item, IDownloadFileCallback::Pointer callback) {
   class DownloadCallback : public IDownloadFileCallback {
@@ -505,6 +744,14 @@ ICloudProvider::MoveItemRequest::Pointer CloudProvider::moveItemAsync(
       ->run();
 }
 
+ICloudProvider::CopyItemRequest::Pointer CloudProvider::copyItemAsync(
+    IItem::Pointer source, std::shared_ptr<ICloudProvider> destination,
+    IItem::Pointer parent, CopyItemCallback callback) {
+  return std::make_shared<cloudstorage::CopyItemRequest>(
+             shared_from_this(), source, destination, parent, callback)
+      ->run();
+}
+
 ICloudProvider::RenameItemRequest::Pointer CloudProvider::renameItemAsync(
     IItem::Pointer item, const std::string& name, RenameItemCallback callback) {
   return std::make_shared<cloudstorage::RenameItemRequest>(shared_from_this(),
@@ -538,9 +785,43 @@ CloudProvider::listDirectorySimpleAsync(IItem::Pointer item,
 ICloudProvider::DownloadFileRequest::Pointer CloudProvider::downloadFileAsync(
     IItem::Pointer item, const std::string& filename,
     DownloadFileCallback callback) {
+  return downloadToFileAsync(item, filename, callback,
+                             DownloadToFileOptions());
+}
+
+ICloudProvider::DownloadFileRequest::Pointer CloudProvider::downloadToFileAsync(
+    IItem::Pointer item, const std::string& path,
+    DownloadFileCallback callback, DownloadToFileOptions options) {
+  auto finished = [=](EitherError<void> e) {
+    return std::make_shared<Request<EitherError<void>>>(
+               shared_from_this(), callback,
+               [=](Request<EitherError<void>>::Pointer r) { r->done(e); })
+        ->run();
+  };
+  auto file = util::make_unique<FileWriter>(path, !options.resume_,
+                                            options.direct_io_);
+  if (!file->good())
+    return finished(
+        Error{IHttpRequest::Failure, util::Error::COULD_NOT_WRITE_FILE});
+  auto offset = file->resume_offset();
+  if (item->size() != IItem::UnknownSize) {
+    if (options.resume_ && offset >= item->size()) {
+      file->close();
+      return finished(nullptr);
+    }
+    file->preallocate(item->size());
+  }
+  // segmented downloads can't start in the middle of the file
+  if (options.segmented_ && offset == 0)
+    return downloadFileSegmentedAsync(
+        item,
+        util::make_unique<FileDownloadCallback>(std::move(file),
+                                                !options.resume_, callback),
+        options.segmented_options_);
   return downloadFileAsync(
-      item, util::make_unique<::DownloadFileCallback>(filename, callback),
-      FullRange);
+      item,
+      util::make_unique<FileDownloadCallback>(std::move(file), false, callback),
+      Range{offset, Range::Full});
 }
 
 ICloudProvider::DownloadFileRequest::Pointer CloudProvider::getThumbnailAsync(
@@ -613,6 +894,31 @@ ICloudProvider::GetItemUrlRequest::Pointer CloudProvider::getFileDaemonUrlAsync(
       ->run();
 }
 
+ICloudProvider::ListChangesRequest::Pointer CloudProvider::listChangesAsync(
+    IItem::Pointer directory, const std::string& cursor,
+    ListChangesCallback callback) {
+  return std::make_shared<cloudstorage::ListChangesRequest>(
+             shared_from_this(), directory, cursor, callback)
+      ->run();
+}
+
+ICloudProvider::DownloadFileRequest::Pointer
+CloudProvider::downloadFileSegmentedAsync(IItem::Pointer item,
+                                          IDownloadFileCallback::Pointer cb,
+                                          SegmentedDownloadOptions options) {
+  return std::make_shared<SegmentedDownloadRequest>(shared_from_this(), item,
+                                                    cb, options)
+      ->run();
+}
+
+ICloudProvider::WalkTreeRequest::Pointer CloudProvider::walkTreeAsync(
+    IItem::Pointer root, IWalkTreeCallback::Pointer callback,
+    WalkTreeOptions options) {
+  return std::make_shared<cloudstorage::WalkTreeRequest>(
+             shared_from_this(), root, callback, options)
+      ->run();
+}
+
 IHttpRequest::Pointer CloudProvider::getItemDataRequest(const std::string&,
                                                         std::ostream&) const {
   return nullptr;
@@ -663,6 +969,11 @@ IHttpRequest::Pointer CloudProvider::moveItemRequest(const IItem&, const IItem&,
   return nullptr;
 }
 
+IHttpRequest::Pointer CloudProvider::copyItemRequest(const IItem&, const IItem&,
+                                                     std::ostream&) const {
+  return nullptr;
+}
+
 IHttpRequest::Pointer CloudProvider::renameItemRequest(const IItem&,
                                                        const std::string&,
                                                        std::ostream&) const {
@@ -689,6 +1000,11 @@ IItem::Pointer CloudProvider::moveItemResponse(const IItem&, const IItem&,
   return getItemDataResponse(response);
 }
 
+IItem::Pointer CloudProvider::copyItemResponse(const IItem&, const IItem&,
+                                               std::istream& response) const {
+  return getItemDataResponse(response);
+}
+
 IItem::Pointer CloudProvider::uploadFileResponse(const IItem&,
                                                  const std::string&, uint64_t,
                                                  std::istream& response) const {
@@ -699,6 +1015,28 @@ GeneralData CloudProvider::getGeneralDataResponse(std::istream&) const {
   return {};
 }
 
+IHttpRequest::Pointer CloudProvider::listChangesRequest(const IItem&,
+                                                        const std::string&,
+                                                        std::ostream&) const {
+  return nullptr;
+}
+
+ChangeData CloudProvider::listChangesResponse(const IItem&, std::istream&,
+                                              bool&) const {
+  return {};
+}
+
+IHttpRequest::Pointer CloudProvider::walkTreeRequest(const IItem&,
+                                                     const std::string&,
+                                                     std::ostream&) const {
+  return nullptr;
+}
+
+CloudProvider::TreeEntries CloudProvider::walkTreeResponse(
+    const IItem&, std::istream&, std::string&) const {
+  return {};
+}
+
 std::string CloudProvider::getItemUrlResponse(
     const IItem&, const IHttpRequest::HeaderParameters&,
     std::istream& stream) const {
@@ -732,6 +1070,21 @@ void CloudProvider::removeStreamRequest(
   stream_requests_.erase(r);
 }
 
+std::string CloudProvider::cachedUrl(const IItem& item) {
+  auto url = url_cache_.get(item.id());
+  return url ? *url : "";
+}
+
+void CloudProvider::cacheUrl(const IItem& item, const std::string& url) {
+  auto lifetime = urlLifetime();
+  if (lifetime.count() <= 0) return;
+  url_cache_.put(item.id(), std::make_shared<std::string>(url), lifetime);
+}
+
+void CloudProvider::invalidateUrl(const IItem& item) {
+  url_cache_.erase(item.id());
+}
+
 ICloudProvider::DownloadFileRequest::Pointer
 CloudProvider::downloadFileRangeAsync(IItem::Pointer item, Range range,
                                       IDownloadFileCallback::Pointer callback) {
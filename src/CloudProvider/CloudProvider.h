@@ -24,6 +24,7 @@
 #ifndef CLOUDPROVIDER_H
 #define CLOUDPROVIDER_H
 
+#include <chrono>
 #include <cstdint>
 #include <mutex>
 #include <sstream>
@@ -33,6 +34,7 @@
 #include "ICloudProvider.h"
 #include "Request/AuthorizeRequest.h"
 #include "Utility/Auth.h"
+#include "Utility/Utility.h"
 
 namespace cloudstorage {
 
@@ -40,6 +42,7 @@ class CloudProvider : public ICloudProvider,
                       public std::enable_shared_from_this<CloudProvider> {
  public:
   using Pointer = std::shared_ptr<CloudProvider>;
+  using TreeEntries = std::vector<std::pair<std::string, IItem::Pointer>>;
 
   CloudProvider(IAuth::Pointer);
 
@@ -58,13 +61,40 @@ class CloudProvider : public ICloudProvider,
   IHttp* http() const;
   IHttpServerFactory* http_server() const;
   IThreadPool* thread_pool() const;
+  IThreadPool* hash_thread_pool();
   IAuthCallback* auth_callback() const;
   std::string file_url() const;
 
   virtual bool isSuccess(int code, const IHttpRequest::HeaderParameters&) const;
 
+  /**
+   * Type of content hash reported by the provider, used for verifying
+   * transferred data.
+   */
+  virtual IItem::HashType hashType() const;
+
+  /**
+   * Path of the local file holding the data of the item with given id, empty
+   * if there is none; the file daemon sends such files straight from disk.
+   */
+  virtual std::string localFilePath(const std::string& id) const;
+
+  /**
+   * How long urls returned by getItemUrlAsync stay valid, downloads reuse
+   * them for that long.
+   */
+  virtual std::chrono::seconds urlLifetime() const;
+
   virtual AuthorizeRequest::Pointer authorizeAsync();
 
+  /**
+   * Looks up the file named filename in directory, completes with null item
+   * if there is none. Lists the whole directory unless overridden.
+   */
+  virtual GetItemRequest::Pointer findFileAsync(IItem::Pointer directory,
+                                                const std::string& filename,
+                                                GetItemCallback);
+
   GetItemUrlRequest::Pointer getItemUrlAsync(IItem::Pointer,
                                              GetItemUrlCallback) override;
   ExchangeCodeRequest::Pointer exchangeCodeAsync(const std::string&,
@@ -76,9 +106,17 @@ class CloudProvider : public ICloudProvider,
   DownloadFileRequest::Pointer downloadFileAsync(IItem::Pointer,
                                                  IDownloadFileCallback::Pointer,
                                                  Range) override;
+  DownloadFileRequest::Pointer downloadFileSegmentedAsync(
+      IItem::Pointer, IDownloadFileCallback::Pointer,
+      SegmentedDownloadOptions) override;
   UploadFileRequest::Pointer uploadFileAsync(
       IItem::Pointer, const std::string&,
       IUploadFileCallback::Pointer) override;
+  UploadFileRequest::Pointer resumeUploadAsync(
+      const std::string& state, IUploadFileCallback::Pointer) override;
+  UploadFileRequest::Pointer uploadFileIfChangedAsync(
+      IItem::Pointer parent, const std::string& filename,
+      IUploadFileCallback::Pointer) override;
   GetItemDataRequest::Pointer getItemDataAsync(const std::string& id,
                                                GetItemDataCallback f) override;
   DownloadFileRequest::Pointer getThumbnailAsync(
@@ -91,6 +129,10 @@ class CloudProvider : public ICloudProvider,
   MoveItemRequest::Pointer moveItemAsync(IItem::Pointer source,
                                          IItem::Pointer destination,
                                          MoveItemCallback) override;
+  CopyItemRequest::Pointer copyItemAsync(IItem::Pointer source,
+                                         std::shared_ptr<ICloudProvider>,
+                                         IItem::Pointer parent,
+                                         CopyItemCallback) override;
   RenameItemRequest::Pointer renameItemAsync(IItem::Pointer item,
                                              const std::string&,
                                              RenameItemCallback) override;
@@ -101,6 +143,9 @@ class CloudProvider : public ICloudProvider,
   DownloadFileRequest::Pointer downloadFileAsync(IItem::Pointer item,
                                                  const std::string& filename,
                                                  DownloadFileCallback) override;
+  DownloadFileRequest::Pointer downloadToFileAsync(
+      IItem::Pointer, const std::string& path, DownloadFileCallback,
+      DownloadToFileOptions) override;
   DownloadFileRequest::Pointer getThumbnailAsync(IItem::Pointer item,
                                                  const std::string& filename,
                                                  GetThumbnailCallback) override;
@@ -111,6 +156,12 @@ class CloudProvider : public ICloudProvider,
   GeneralDataRequest::Pointer getGeneralDataAsync(GeneralDataCallback) override;
   GetItemUrlRequest::Pointer getFileDaemonUrlAsync(IItem::Pointer,
                                                    GetItemUrlCallback) override;
+  ListChangesRequest::Pointer listChangesAsync(IItem::Pointer,
+                                               const std::string& cursor,
+                                               ListChangesCallback) override;
+  WalkTreeRequest::Pointer walkTreeAsync(IItem::Pointer,
+                                         IWalkTreeCallback::Pointer,
+                                         WalkTreeOptions) override;
 
   /**
    * Used by default implementation of getItemDataAsync.
@@ -198,6 +249,18 @@ class CloudProvider : public ICloudProvider,
                                                 const IItem& destination,
                                                 std::ostream&) const;
 
+  /**
+   * Used by copyItemAsync when copying within the same account; providers
+   * which can't copy on their own return nullptr.
+   *
+   * @param source
+   * @param destination
+   * @return http request
+   */
+  virtual IHttpRequest::Pointer copyItemRequest(const IItem& source,
+                                                const IItem& destination,
+                                                std::ostream&) const;
+
   /**
    * Used by default implementation of renameItemAsync.
    *
@@ -211,6 +274,34 @@ class CloudProvider : public ICloudProvider,
 
   virtual IHttpRequest::Pointer getGeneralDataRequest(std::ostream&) const;
 
+  /**
+   * Used by default implementation of listChangesAsync; if nullptr is
+   * returned, changes are found by comparing directory listings.
+   *
+   * @param directory
+   * @param cursor cursor to continue from, empty if querying for the initial
+   * cursor
+   * @param input_stream request body
+   * @return http request
+   */
+  virtual IHttpRequest::Pointer listChangesRequest(
+      const IItem& directory, const std::string& cursor,
+      std::ostream& input_stream) const;
+
+  /**
+   * Used by default implementation of walkTreeAsync; should return a request
+   * listing the whole subtree at once. If nullptr is returned, directories
+   * are listed one by one.
+   *
+   * @param root
+   * @param page_token empty when requesting the first page
+   * @param input_stream request body
+   * @return http request
+   */
+  virtual IHttpRequest::Pointer walkTreeRequest(
+      const IItem& root, const std::string& page_token,
+      std::ostream& input_stream) const;
+
   /**
    * Used by default implementation of getItemDataAsync, should translate
    * reponse into IItem object.
@@ -246,12 +337,43 @@ class CloudProvider : public ICloudProvider,
   virtual IItem::Pointer moveItemResponse(const IItem&, const IItem&,
                                           std::istream&) const;
 
+  virtual IItem::Pointer copyItemResponse(const IItem&, const IItem&,
+                                          std::istream&) const;
+
   virtual IItem::Pointer uploadFileResponse(const IItem& parent,
                                             const std::string& filename,
                                             uint64_t size,
                                             std::istream& response) const;
   virtual GeneralData getGeneralDataResponse(std::istream& response) const;
 
+  /**
+   * Used by default implementation of listChangesAsync, should extract changes
+   * from response.
+   *
+   * @param directory
+   * @param response
+   * @param has_more should be set to true if more changes can be fetched
+   * right away using the returned cursor
+   * @return changes
+   */
+  virtual ChangeData listChangesResponse(const IItem& directory,
+                                         std::istream& response,
+                                         bool& has_more) const;
+
+  /**
+   * Used by default implementation of walkTreeAsync, should extract items
+   * from response of walkTreeRequest.
+   *
+   * @param root
+   * @param response
+   * @param next_page_token should be set to string describing the next page
+   * or to empty string if there is no next page
+   * @return pairs of item's path relative to the root and item
+   */
+  virtual TreeEntries walkTreeResponse(const IItem& root,
+                                       std::istream& response,
+                                       std::string& next_page_token) const;
+
   /**
    * Used by default implementation of createDirectoryAsync, should translate
    * response into new directory's item object.
@@ -291,6 +413,20 @@ class CloudProvider : public ICloudProvider,
   static Json::Value credentialsFromString(const std::string&);
   static std::string credentialsToString(const Json::Value& json);
 
+  /**
+   * Serializes provider specific upload session data along with the
+   * committed offset, to be reported with IUploadFileCallback::uploadSession.
+   */
+  std::string uploadSessionToString(Json::Value session, uint64_t offset,
+                                    uint64_t size) const;
+
+  /**
+   * Parses state created by uploadSessionToString; returns null value if the
+   * state wasn't created by this provider or for a file of different size.
+   */
+  Json::Value uploadSessionFromString(const std::string& state,
+                                      uint64_t size) const;
+
   void addStreamRequest(const std::shared_ptr<DownloadFileRequest>&);
   void removeStreamRequest(
       const std::shared_ptr<ICloudProvider::DownloadFileRequest>&);
@@ -298,6 +434,14 @@ class CloudProvider : public ICloudProvider,
   DownloadFileRequest::Pointer downloadFileRangeAsync(
       IItem::Pointer, Range, IDownloadFileCallback::Pointer);
 
+  /**
+   * Returns item's url resolved by an earlier download, empty if there is
+   * none or it has expired.
+   */
+  std::string cachedUrl(const IItem&);
+  void cacheUrl(const IItem&, const std::string& url);
+  void invalidateUrl(const IItem&);
+
  protected:
   void setWithHint(const Hints& hints, const std::string& name,
                    const std::function<void(std::string)>&) const;
@@ -309,6 +453,7 @@ class CloudProvider : public ICloudProvider,
   template <class T>
   friend class Request;
 
+  // Downloads thumbnails, which aren't checked against the item's hash.
   DownloadFileRequest::Pointer makeDownloadFileRequest(
       IItem::Pointer file, Range,
       std::function<IHttpRequest::Pointer(const IItem&, std::ostream&)>,
@@ -320,6 +465,7 @@ class CloudProvider : public ICloudProvider,
   IHttp::Pointer http_;
   IHttpServerFactory::Pointer http_server_;
   IThreadPool::Pointer thread_pool_;
+  IThreadPool::Pointer hash_thread_pool_;
   AuthorizeRequest::Pointer current_authorization_;
   std::unordered_map<IGenericRequest*,
                      std::vector<AuthorizeRequest::AuthorizeCompleted>>
@@ -327,8 +473,10 @@ class CloudProvider : public ICloudProvider,
   std::unordered_set<std::shared_ptr<ICloudProvider::DownloadFileRequest>>
       stream_requests_;
   std::string file_url_;
+  util::LRUCache<std::string, std::string> url_cache_;
   IHttpServer::Pointer file_daemon_;
   std::mutex stream_request_mutex_;
+  std::mutex hash_thread_pool_mutex_;
   std::mutex current_authorization_mutex_;
   mutable std::mutex auth_mutex_;
   bool deleted_;
@@ -27,27 +27,50 @@
 #include <algorithm>
 #include <sstream>
 
+#include "Utility/ChunkReader.h"
 #include "Utility/Item.h"
 #include "Utility/Utility.h"
 
 #include "Request/Request.h"
 
 const std::string DROPBOXAPI_ENDPOINT = "https://api.dropboxapi.com";
-const int CHUNK_SIZE = 60 * 1024 * 1024;
+const uint32_t DEFAULT_CHUNK_SIZE = 60 * 1024 * 1024;
+// upload session requests may carry at most 150 MiB
+const uint32_t MAX_CHUNK_SIZE = 150 * 1024 * 1024;
+const uint32_t MIN_CHUNK_SIZE = 1024 * 1024;
 
 namespace cloudstorage {
 
 namespace {
+// offset expected by the server if the request failed with incorrect_offset
+bool correctOffset(const std::string& error, uint64_t& offset) {
+  try {
+    auto json = util::json::from_string(error)["error"];
+    if (json[".tag"].asString() == "lookup_failed")
+      json = json["lookup_failed"];
+    if (json[".tag"].asString() != "incorrect_offset") return false;
+    offset = json["correct_offset"].asUInt64();
+    return true;
+  } catch (const Json::Exception&) {
+    return false;
+  }
+}
+
 void upload(const Request<EitherError<IItem>>::Pointer& r,
             const std::string& session_id, const std::string& path,
-            uint64_t sent, IUploadFileCallback* callback) {
-  auto size = callback->size();
-  auto length = std::make_shared<uint64_t>(0);
+            uint64_t sent, const ChunkReader::Pointer& reader,
+            IUploadFileCallback* callback) {
+  auto size = reader->size();
+  auto length = std::make_shared<uint32_t>(0);
+  if (!session_id.empty()) {
+    Json::Value session;
+    session["session_id"] = session_id;
+    session["path"] = path;
+    callback->uploadSession(
+        r->provider()->uploadSessionToString(session, sent, size));
+  }
   r->send(
-      [=](util::Output stream) {
-        std::vector<char> buffer(CHUNK_SIZE);
-        if (sent < size)
-          *length = callback->putData(buffer.data(), CHUNK_SIZE, sent);
+      [=](util::Output) {
         std::string upload_url =
             "https://content.dropboxapi.com/2/files/upload_session";
         Json::Value json;
@@ -67,10 +90,14 @@ void upload(const Request<EitherError<IItem>>::Pointer& r,
         request->setHeaderParameter("Content-Type", "application/octet-stream");
         request->setHeaderParameter("Dropbox-API-Arg",
                                     util::json::to_string(json));
-        stream->write(buffer.data(), *length);
         return request;
       },
       [=](EitherError<Response> e) {
+        uint64_t offset;
+        if (e.left() && !session_id.empty() &&
+            correctOffset(e.left()->description_, offset) && offset != sent &&
+            offset <= size)
+          return upload(r, session_id, path, offset, reader, callback);
         if (e.left()) return r->done(e.left());
         try {
           auto json = util::json::from_stream(e.right()->output());
@@ -78,24 +105,51 @@ void upload(const Request<EitherError<IItem>>::Pointer& r,
             upload(
                 r,
                 session_id.empty() ? json["session_id"].asString() : session_id,
-                path, sent + *length, callback);
-          else
-            r->done(Dropbox::toItem(json));
+                path, sent + *length, reader, callback);
+          else {
+            auto item = Dropbox::toItem(json);
+            if (!reader->verify(*item))
+              return r->done(Error{IHttpRequest::Failure,
+                                   util::Error::CONTENT_HASH_MISMATCH});
+            r->done(item);
+          }
         } catch (const Json::Exception&) {
           r->done(Error{IHttpRequest::Failure, e.right()->output().str()});
         }
       },
-      [] { return std::make_shared<std::stringstream>(); },
+      [=] { return reader->read(sent, *length); },
       std::make_shared<std::stringstream>(), nullptr,
       [=](uint64_t, uint64_t now) { callback->progress(size, sent + now); },
       true);
 }
 }  // namespace
 
-Dropbox::Dropbox() : CloudProvider(util::make_unique<Auth>()) {}
+Dropbox::Dropbox()
+    : CloudProvider(util::make_unique<Auth>()),
+      chunk_size_(DEFAULT_CHUNK_SIZE) {}
+
+void Dropbox::initialize(InitData&& data) {
+  setWithHint(data.hints_, "upload_chunk_size", [=](std::string v) {
+    chunk_size_ = static_cast<uint32_t>(std::min<uint64_t>(
+        std::max<uint64_t>(std::strtoull(v.c_str(), nullptr, 10),
+                           MIN_CHUNK_SIZE),
+        MAX_CHUNK_SIZE));
+  });
+  CloudProvider::initialize(std::move(data));
+}
+
+ICloudProvider::Hints Dropbox::hints() const {
+  auto hints = CloudProvider::hints();
+  hints.insert({{"upload_chunk_size", std::to_string(chunk_size_)}});
+  return hints;
+}
 
 std::string Dropbox::name() const { return "dropbox"; }
 
+IItem::HashType Dropbox::hashType() const {
+  return IItem::HashType::DropboxContentHash;
+}
+
 std::string Dropbox::endpoint() const { return DROPBOXAPI_ENDPOINT; }
 
 IItem::Pointer Dropbox::rootDirectory() const {
@@ -116,11 +170,60 @@ ICloudProvider::UploadFileRequest::Pointer Dropbox::uploadFileAsync(
   return std::make_shared<Request<EitherError<IItem>>>(
              shared_from_this(), [=](EitherError<IItem> e) { cb->done(e); },
              [=](Request<EitherError<IItem>>::Pointer r) {
-               upload(r, "", parent->id() + "/" + filename, 0, callback);
+               upload(r, "", parent->id() + "/" + filename, 0,
+                      std::make_shared<ChunkReader>(cb, chunk_size_,
+                                                    hashType()),
+                      callback);
+             })
+      ->run();
+}
+
+ICloudProvider::UploadFileRequest::Pointer Dropbox::resumeUploadAsync(
+    const std::string& state, IUploadFileCallback::Pointer cb) {
+  auto callback = cb.get();
+  auto session = uploadSessionFromString(state, cb->size());
+  return std::make_shared<Request<EitherError<IItem>>>(
+             shared_from_this(), [=](EitherError<IItem> e) { cb->done(e); },
+             [=](Request<EitherError<IItem>>::Pointer r) {
+               if (session.isNull() || session["session_id"].asString().empty())
+                 return r->done(Error{IHttpRequest::Bad,
+                                      util::Error::INVALID_UPLOAD_SESSION});
+               upload(r, session["session_id"].asString(),
+                      session["path"].asString(), session["offset"].asUInt64(),
+                      std::make_shared<ChunkReader>(cb, chunk_size_,
+                                                    hashType()),
+                      callback);
              })
       ->run();
 }
 
+ICloudProvider::GetItemRequest::Pointer Dropbox::findFileAsync(
+    IItem::Pointer directory, const std::string& filename,
+    GetItemCallback callback) {
+  auto resolver = [=](Request<EitherError<IItem>>::Pointer r) {
+    r->request(
+        [=](util::Output input) {
+          return getItemDataRequest(directory->id() + "/" + filename, *input);
+        },
+        [=](EitherError<Response> e) {
+          if (e.left()) {
+            if (e.left()->code_ == IHttpRequest::Conflict &&
+                e.left()->description_.find("not_found") != std::string::npos)
+              return r->done(IItem::Pointer());
+            return r->done(e.left());
+          }
+          try {
+            r->done(getItemDataResponse(e.right()->output()));
+          } catch (const std::exception&) {
+            r->done(Error{IHttpRequest::Failure, e.right()->output().str()});
+          }
+        });
+  };
+  return std::make_shared<Request<EitherError<IItem>>>(shared_from_this(),
+                                                       callback, resolver)
+      ->run();
+}
+
 ICloudProvider::GeneralDataRequest::Pointer Dropbox::getGeneralDataAsync(
     GeneralDataCallback callback) {
   auto resolver = [=](Request<EitherError<GeneralData>>::Pointer r) {
@@ -280,6 +383,18 @@ IHttpRequest::Pointer Dropbox::moveItemRequest(const IItem& source,
   return request;
 }
 
+IHttpRequest::Pointer Dropbox::copyItemRequest(const IItem& source,
+                                               const IItem& destination,
+                                               std::ostream& stream) const {
+  auto request = http()->create(endpoint() + "/2/files/copy_v2", "POST");
+  request->setHeaderParameter("Content-Type", "application/json");
+  Json::Value json;
+  json["from_path"] = source.id();
+  json["to_path"] = destination.id() + "/" + source.filename();
+  stream << json;
+  return request;
+}
+
 IHttpRequest::Pointer Dropbox::renameItemRequest(const IItem& item,
                                                  const std::string& name,
                                                  std::ostream& stream) const {
@@ -303,6 +418,81 @@ IItem::List Dropbox::listDirectoryResponse(const IItem&, std::istream& stream,
   return result;
 }
 
+IHttpRequest::Pointer Dropbox::listChangesRequest(
+    const IItem& item, const std::string& cursor,
+    std::ostream& input_stream) const {
+  Json::Value input;
+  IHttpRequest::Pointer request;
+  if (cursor.empty()) {
+    request = http()->create(
+        endpoint() + "/2/files/list_folder/get_latest_cursor", "POST");
+    input["path"] = item.id();
+    input["recursive"] = true;
+    input["include_deleted"] = true;
+  } else {
+    request =
+        http()->create(endpoint() + "/2/files/list_folder/continue", "POST");
+    input["cursor"] = cursor;
+  }
+  request->setHeaderParameter("Content-Type", "application/json");
+  input_stream << util::json::to_string(input);
+  return request;
+}
+
+ChangeData Dropbox::listChangesResponse(const IItem&, std::istream& stream,
+                                        bool& has_more) const {
+  auto response = util::json::from_stream(stream);
+  ChangeData result;
+  for (const Json::Value& v : response["entries"]) {
+    if (v[".tag"].asString() == "deleted")
+      result.deleted_.push_back(v["path_display"].asString());
+    else
+      result.items_.push_back(toItem(v));
+  }
+  result.cursor_ = response["cursor"].asString();
+  has_more = response["has_more"].asBool();
+  return result;
+}
+
+IHttpRequest::Pointer Dropbox::walkTreeRequest(
+    const IItem& item, const std::string& page_token,
+    std::ostream& input_stream) const {
+  Json::Value input;
+  IHttpRequest::Pointer request;
+  if (page_token.empty()) {
+    request = http()->create(endpoint() + "/2/files/list_folder", "POST");
+    input["path"] = item.id();
+    input["recursive"] = true;
+  } else {
+    request =
+        http()->create(endpoint() + "/2/files/list_folder/continue", "POST");
+    input["cursor"] = page_token;
+  }
+  request->setHeaderParameter("Content-Type", "application/json");
+  input_stream << util::json::to_string(input);
+  return request;
+}
+
+CloudProvider::TreeEntries Dropbox::walkTreeResponse(
+    const IItem& root, std::istream& stream,
+    std::string& next_page_token) const {
+  auto response = util::json::from_stream(stream);
+  auto prefix = util::to_lower(root.id());
+  TreeEntries result;
+  for (const Json::Value& v : response["entries"]) {
+    auto path = v["path_lower"].asString();
+    if (path.length() <= prefix.length() + 1 ||
+        path.substr(0, prefix.length()) != prefix)
+      continue;
+    auto item = toItem(v);
+    result.push_back(
+        {item->id().substr(prefix.length() + 1), std::move(item)});
+  }
+  if (response["has_more"].asBool())
+    next_page_token = response["cursor"].asString();
+  return result;
+}
+
 IItem::Pointer Dropbox::createDirectoryResponse(const IItem&,
                                                 const std::string&,
                                                 std::istream& response) const {
@@ -325,13 +515,23 @@ IItem::Pointer Dropbox::moveItemResponse(const IItem& source, const IItem&,
   return item;
 }
 
+IItem::Pointer Dropbox::copyItemResponse(const IItem& source,
+                                         const IItem& destination,
+                                         std::istream& response) const {
+  return moveItemResponse(source, destination, response);
+}
+
 IItem::Pointer Dropbox::toItem(const Json::Value& v) {
   IItem::FileType type = IItem::FileType::Unknown;
   if (v[".tag"].asString() == "folder") type = IItem::FileType::Directory;
-  return util::make_unique<Item>(
+  auto item = util::make_unique<Item>(
       v["name"].asString(), v["path_display"].asString(),
       v.isMember("size") ? v["size"].asUInt64() : IItem::UnknownSize,
       util::parse_time(v["client_modified"].asString()), type);
+  if (v.isMember("content_hash"))
+    item->set_hash(IItem::HashType::DropboxContentHash,
+                   v["content_hash"].asString());
+  return std::move(item);
 }
 
 void Dropbox::Auth::initialize(IHttp* http, IHttpServerFactory* factory) {
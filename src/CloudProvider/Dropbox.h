@@ -34,15 +34,24 @@ class Dropbox : public CloudProvider {
  public:
   Dropbox();
 
+  void initialize(InitData&&) override;
+  Hints hints() const override;
+
   std::string name() const override;
+  IItem::HashType hashType() const override;
   std::string endpoint() const override;
   IItem::Pointer rootDirectory() const override;
   bool reauthorize(int code,
                    const IHttpRequest::HeaderParameters&) const override;
+  UploadFileRequest::Pointer resumeUploadAsync(
+      const std::string& state, IUploadFileCallback::Pointer) override;
   UploadFileRequest::Pointer uploadFileAsync(
       IItem::Pointer, const std::string& filename,
       IUploadFileCallback::Pointer) override;
   GeneralDataRequest::Pointer getGeneralDataAsync(GeneralDataCallback) override;
+  GetItemRequest::Pointer findFileAsync(IItem::Pointer directory,
+                                        const std::string& filename,
+                                        GetItemCallback) override;
 
   IHttpRequest::Pointer getItemUrlRequest(
       const IItem&, std::ostream& input_stream) const override;
@@ -62,9 +71,17 @@ class Dropbox : public CloudProvider {
                                                std::ostream&) const override;
   IHttpRequest::Pointer moveItemRequest(const IItem&, const IItem&,
                                         std::ostream&) const override;
+  IHttpRequest::Pointer copyItemRequest(const IItem&, const IItem&,
+                                        std::ostream&) const override;
   IHttpRequest::Pointer renameItemRequest(const IItem& item,
                                           const std::string& name,
                                           std::ostream&) const override;
+  IHttpRequest::Pointer listChangesRequest(const IItem&,
+                                           const std::string& cursor,
+                                           std::ostream&) const override;
+  IHttpRequest::Pointer walkTreeRequest(const IItem&,
+                                        const std::string& page_token,
+                                        std::ostream&) const override;
 
   IItem::List listDirectoryResponse(
       const IItem&, std::istream&, std::string& next_page_token) const override;
@@ -80,6 +97,12 @@ class Dropbox : public CloudProvider {
                                     std::istream& response) const override;
   IItem::Pointer moveItemResponse(const IItem&, const IItem&,
                                   std::istream&) const override;
+  IItem::Pointer copyItemResponse(const IItem&, const IItem&,
+                                  std::istream&) const override;
+  ChangeData listChangesResponse(const IItem&, std::istream&,
+                                 bool& has_more) const override;
+  TreeEntries walkTreeResponse(const IItem&, std::istream&,
+                               std::string& next_page_token) const override;
   void authorizeRequest(IHttpRequest&) const override;
 
   static IItem::Pointer toItem(const Json::Value&);
@@ -100,6 +123,8 @@ class Dropbox : public CloudProvider {
         std::istream&) const override;
     Token::Pointer refreshTokenResponse(std::istream&) const override;
   };
+
+  uint32_t chunk_size_;
 };
 
 }  // namespace cloudstorage
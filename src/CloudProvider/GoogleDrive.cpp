@@ -30,6 +30,7 @@
 
 #include "Request/DownloadFileRequest.h"
 #include "Request/UploadFileRequest.h"
+#include "Utility/ChunkReader.h"
 #include "Utility/Item.h"
 #include "Utility/Utility.h"
 
@@ -37,6 +38,12 @@ const std::string GOOGLEAPI_ENDPOINT = "https://www.googleapis.com";
 const std::string SHARED_ID = "shared";
 const std::string SHARED_FILENAME = "Shared with me";
 const auto THUMBNAIL_SIZE = 256;
+// resumable upload chunks must be a multiple of 256 KiB; files not larger
+// than a single chunk are sent with a multipart upload
+const uint32_t RESUMABLE_CHUNK_SIZE = 32 * 256 * 1024;
+const std::string UPLOAD_FIELDS =
+    "id,name,thumbnailLink,trashed,mimeType,iconLink,parents,size,"
+    "modifiedTime,md5Checksum";
 
 using namespace std::placeholders;
 
@@ -44,6 +51,65 @@ namespace cloudstorage {
 
 namespace {
 
+// number of bytes the server already has, from the range header of
+// 308 Resume Incomplete response
+uint64_t committedBytes(const IHttpRequest::HeaderParameters& headers) {
+  auto it = headers.find("range");
+  if (it == headers.end()) return 0;
+  auto separator = it->second.find('-');
+  if (separator == std::string::npos) return 0;
+  return std::strtoull(it->second.c_str() + separator + 1, nullptr, 10) + 1;
+}
+
+void uploadChunks(const Request<EitherError<IItem>>::Pointer& r,
+                  const std::string& session_url, uint64_t sent,
+                  const ChunkReader::Pointer& reader,
+                  IUploadFileCallback* callback) {
+  auto provider = static_cast<GoogleDrive*>(r->provider().get());
+  auto size = reader->size();
+  auto length = std::make_shared<uint32_t>(0);
+  Json::Value session;
+  session["session_url"] = session_url;
+  callback->uploadSession(
+      provider->uploadSessionToString(session, sent, size));
+  r->send(
+      [=](util::Output) {
+        auto request = r->provider()->http()->create(session_url, "PUT");
+        std::stringstream content_range;
+        if (*length > 0)
+          content_range << "bytes " << sent << "-" << sent + *length - 1 << "/"
+                        << size;
+        else
+          content_range << "bytes */" << size;
+        request->setHeaderParameter("Content-Range", content_range.str());
+        return request;
+      },
+      [=](EitherError<Response> e) {
+        if (e.left()) return r->done(e.left());
+        if (e.right()->http_code() == 308) {
+          auto committed = committedBytes(e.right()->headers());
+          if (committed <= sent && *length > 0)
+            return r->done(Error{IHttpRequest::Failure,
+                                 util::Error::INVALID_UPLOAD_SESSION});
+          return uploadChunks(r, session_url, committed, reader, callback);
+        }
+        try {
+          auto item =
+              provider->toItem(util::json::from_stream(e.right()->output()));
+          if (!reader->verify(*item))
+            return r->done(Error{IHttpRequest::Failure,
+                                 util::Error::CONTENT_HASH_MISMATCH});
+          r->done(item);
+        } catch (const Json::Exception&) {
+          r->done(Error{IHttpRequest::Failure, e.right()->output().str()});
+        }
+      },
+      [=] { return reader->read(sent, *length); },
+      std::make_shared<std::stringstream>(), nullptr,
+      [=](uint64_t, uint64_t now) { callback->progress(size, sent + now); },
+      true);
+}
+
 std::string exported_mime_type(const std::string& type) {
   if (type == "application/vnd.google-apps.document")
     return "application/"
@@ -98,10 +164,21 @@ std::string icon_link(const std::string& link) {
 
 }  // namespace
 
-GoogleDrive::GoogleDrive() : CloudProvider(util::make_unique<Auth>()) {}
+GoogleDrive::GoogleDrive()
+    : CloudProvider(util::make_unique<Auth>()), check_existing_(true) {}
+
+void GoogleDrive::initialize(InitData&& data) {
+  setWithHint(data.hints_, "upload_check_existing", [=](std::string v) {
+    auto lock = auth_lock();
+    check_existing_ = v != "false";
+  });
+  CloudProvider::initialize(std::move(data));
+}
 
 std::string GoogleDrive::name() const { return "google"; }
 
+IItem::HashType GoogleDrive::hashType() const { return IItem::HashType::MD5; }
+
 std::string GoogleDrive::endpoint() const { return GOOGLEAPI_ENDPOINT; }
 
 IHttpRequest::Pointer GoogleDrive::getItemUrlRequest(
@@ -127,8 +204,8 @@ IHttpRequest::Pointer GoogleDrive::getItemDataRequest(const std::string& id,
                                                       std::ostream&) const {
   auto request = http()->create(endpoint() + "/drive/v3/files/" + id, "GET");
   request->setParameter("fields",
-                        "id,name,thumbnailLink,trashed,"
-                        "mimeType,iconLink,parents,size,modifiedTime");
+                        "id,name,thumbnailLink,trashed,mimeType,iconLink,"
+                        "parents,size,modifiedTime,md5Checksum");
   return request;
 }
 
@@ -141,9 +218,9 @@ IHttpRequest::Pointer GoogleDrive::listDirectoryRequest(
   else
     request->setParameter("q", std::string("'") + item.id() + "'+in+parents");
   request->setParameter("fields",
-                        "files(id,name,thumbnailLink,trashed,"
-                        "mimeType,iconLink,parents,size,modifiedTime),kind,"
-                        "nextPageToken");
+                        "files(id,name,thumbnailLink,trashed,mimeType,"
+                        "iconLink,parents,size,modifiedTime,md5Checksum),"
+                        "kind,nextPageToken");
   if (!page_token.empty()) request->setParameter("pageToken", page_token);
   return request;
 }
@@ -187,7 +264,8 @@ ICloudProvider::DownloadFileRequest::Pointer GoogleDrive::downloadFileAsync(
   }
   return std::make_shared<cloudstorage::DownloadFileRequest>(
              shared_from_this(), std::move(file), std::move(callback), range,
-             std::bind(&CloudProvider::downloadFileRequest, this, _1, _2))
+             std::bind(&CloudProvider::downloadFileRequest, this, _1, _2),
+             true)
       ->run();
 }
 
@@ -195,21 +273,43 @@ ICloudProvider::UploadFileRequest::Pointer GoogleDrive::uploadFileAsync(
     IItem::Pointer directory, const std::string& filename,
     IUploadFileCallback::Pointer cb) {
   auto resolve = [=](Request<EitherError<IItem>>::Pointer r) {
-    auto resolve_directory = [=](EitherError<IItem::List> e) {
-      if (e.left()) return r->done(e.left());
+    auto resolve_directory = [=](const IItem::List& list) {
       IItem::Pointer item = nullptr;
       int cnt = 0;
-      for (auto&& i : *e.right())
+      for (auto&& i : list)
         if (i->filename() == filename) {
           item = i;
           cnt++;
         }
+      if (cb->size() > RESUMABLE_CHUNK_SIZE) {
+        auto url = endpoint() + "/upload/drive/v3/files";
+        if (cnt == 1) url += "/" + item->id();
+        auto method = cnt == 1 ? "PATCH" : "POST";
+        return r->request(
+            [=](util::Output input) {
+              return uploadSessionRequest(*directory, url, method, filename,
+                                          cb->size(), *input);
+            },
+            [=](EitherError<Response> e) {
+              if (e.left()) return r->done(e.left());
+              auto it = e.right()->headers().find("location");
+              if (it == e.right()->headers().end())
+                return r->done(Error{IHttpRequest::Failure,
+                                     util::Error::INVALID_UPLOAD_SESSION});
+              uploadChunks(
+                  r, it->second, 0,
+                  std::make_shared<ChunkReader>(cb, RESUMABLE_CHUNK_SIZE,
+                                                hashType()),
+                  cb.get());
+            });
+      }
       auto stream_wrapper = std::make_shared<UploadStreamWrapper>(
           std::bind(&IUploadFileCallback::putData, cb.get(), _1, _2, _3),
           cb->size());
       if (cnt != 1)
         return cloudstorage::UploadFileRequest::resolve(
             r, stream_wrapper, directory, filename, cb);
+      stream_wrapper->hash_type_ = hashType();
       r->send(
           [=](util::Output) {
             stream_wrapper->reset();
@@ -221,9 +321,13 @@ ICloudProvider::UploadFileRequest::Pointer GoogleDrive::uploadFileAsync(
           [=](EitherError<Response> e) {
             if (e.left()) return r->done(e.left());
             try {
-              r->done(r->provider()->uploadFileResponse(*directory, filename,
-                                                        stream_wrapper->size_,
-                                                        e.right()->output()));
+              auto item = r->provider()->uploadFileResponse(
+                  *directory, filename, stream_wrapper->size_,
+                  e.right()->output());
+              if (!stream_wrapper->verify(*item))
+                return r->done(Error{IHttpRequest::Failure,
+                                     util::Error::CONTENT_HASH_MISMATCH});
+              r->done(item);
             } catch (const std::exception&) {
               r->done(Error{IHttpRequest::Failure, e.right()->output().str()});
             }
@@ -232,8 +336,22 @@ ICloudProvider::UploadFileRequest::Pointer GoogleDrive::uploadFileAsync(
           std::make_shared<std::stringstream>(), nullptr,
           std::bind(&IUploadFileCallback::progress, cb, _1, _2), true);
     };
-    r->make_subrequest(&GoogleDrive::listDirectorySimpleAsync, directory,
-                       resolve_directory);
+    if (!check_existing()) return resolve_directory(IItem::List());
+    r->request(
+        [=](util::Output) { return findFileRequest(*directory, filename); },
+        [=](EitherError<Response> e) {
+          if (e.left()) return r->done(e.left());
+          IItem::List list;
+          try {
+            std::string next_page_token;
+            list = listDirectoryResponse(*directory, e.right()->output(),
+                                         next_page_token);
+          } catch (const std::exception&) {
+            return r->done(
+                Error{IHttpRequest::Failure, e.right()->output().str()});
+          }
+          resolve_directory(list);
+        });
   };
   return std::make_shared<Request<EitherError<IItem>>>(
              shared_from_this(), [=](EitherError<IItem> e) { cb->done(e); },
@@ -241,6 +359,46 @@ ICloudProvider::UploadFileRequest::Pointer GoogleDrive::uploadFileAsync(
       ->run();
 }
 
+ICloudProvider::UploadFileRequest::Pointer GoogleDrive::resumeUploadAsync(
+    const std::string& state, IUploadFileCallback::Pointer cb) {
+  auto session = uploadSessionFromString(state, cb->size());
+  return std::make_shared<Request<EitherError<IItem>>>(
+             shared_from_this(), [=](EitherError<IItem> e) { cb->done(e); },
+             [=](Request<EitherError<IItem>>::Pointer r) {
+               if (session.isNull())
+                 return r->done(Error{IHttpRequest::Bad,
+                                      util::Error::INVALID_UPLOAD_SESSION});
+               auto session_url = session["session_url"].asString();
+               auto reader =
+                   std::make_shared<ChunkReader>(cb, RESUMABLE_CHUNK_SIZE,
+                                                 hashType());
+               r->send(
+                   [=](util::Output) {
+                     auto request = http()->create(session_url, "PUT");
+                     request->setHeaderParameter(
+                         "Content-Range",
+                         "bytes */" + std::to_string(cb->size()));
+                     return request;
+                   },
+                   [=](EitherError<Response> e) {
+                     if (e.left()) return r->done(e.left());
+                     if (e.right()->http_code() == 308)
+                       return uploadChunks(
+                           r, session_url,
+                           committedBytes(e.right()->headers()), reader,
+                           cb.get());
+                     try {
+                       r->done(toItem(
+                           util::json::from_stream(e.right()->output())));
+                     } catch (const Json::Exception&) {
+                       r->done(Error{IHttpRequest::Failure,
+                                     e.right()->output().str()});
+                     }
+                   });
+             })
+      ->run();
+}
+
 IHttpRequest::Pointer GoogleDrive::deleteItemRequest(const IItem& item,
                                                      std::ostream&) const {
   return http()->create(endpoint() + "/drive/v3/files/" + item.id(), "DELETE");
@@ -251,8 +409,8 @@ IHttpRequest::Pointer GoogleDrive::createDirectoryRequest(
   auto request = http()->create(endpoint() + "/drive/v3/files", "POST");
   request->setHeaderParameter("Content-Type", "application/json");
   request->setParameter("fields",
-                        "id,name,thumbnailLink,trashed,"
-                        "mimeType,iconLink,parents,size,modifiedTime");
+                        "id,name,thumbnailLink,trashed,mimeType,iconLink,"
+                        "parents,size,modifiedTime,md5Checksum");
   Json::Value json;
   json["mimeType"] = "application/vnd.google-apps.folder";
   json["name"] = name;
@@ -269,8 +427,8 @@ IHttpRequest::Pointer GoogleDrive::moveItemRequest(const IItem& s,
       http()->create(endpoint() + "/drive/v3/files/" + source.id(), "PATCH");
   request->setHeaderParameter("Content-Type", "application/json");
   request->setParameter("fields",
-                        "id,name,thumbnailLink,trashed,"
-                        "mimeType,iconLink,parents,size,modifiedTime");
+                        "id,name,thumbnailLink,trashed,mimeType,iconLink,"
+                        "parents,size,modifiedTime,md5Checksum");
   std::string current_parents;
   for (const auto& str : source.parents()) current_parents += str + ",";
   current_parents.pop_back();
@@ -280,14 +438,30 @@ IHttpRequest::Pointer GoogleDrive::moveItemRequest(const IItem& s,
   return request;
 }
 
+IHttpRequest::Pointer GoogleDrive::copyItemRequest(const IItem& source,
+                                                   const IItem& destination,
+                                                   std::ostream& input) const {
+  if (source.type() == IItem::FileType::Directory) return nullptr;
+  auto request = http()->create(
+      endpoint() + "/drive/v3/files/" + source.id() + "/copy", "POST");
+  request->setHeaderParameter("Content-Type", "application/json");
+  request->setParameter("fields",
+                        "id,name,thumbnailLink,trashed,mimeType,iconLink,"
+                        "parents,size,modifiedTime,md5Checksum");
+  Json::Value json;
+  json["parents"].append(destination.id());
+  input << json;
+  return request;
+}
+
 IHttpRequest::Pointer GoogleDrive::renameItemRequest(
     const IItem& item, const std::string& name, std::ostream& input) const {
   auto request =
       http()->create(endpoint() + "/drive/v3/files/" + item.id(), "PATCH");
   request->setHeaderParameter("Content-Type", "application/json");
   request->setParameter("fields",
-                        "id,name,thumbnailLink,trashed,"
-                        "mimeType,iconLink,parents,size,modifiedTime");
+                        "id,name,thumbnailLink,trashed,mimeType,iconLink,"
+                        "parents,size,modifiedTime,md5Checksum");
   Json::Value json;
   json["name"] = name;
   input << json;
@@ -300,6 +474,21 @@ IHttpRequest::Pointer GoogleDrive::getGeneralDataRequest(std::ostream&) const {
   return request;
 }
 
+IHttpRequest::Pointer GoogleDrive::listChangesRequest(const IItem&,
+                                                      const std::string& cursor,
+                                                      std::ostream&) const {
+  if (cursor.empty())
+    return http()->create(endpoint() + "/drive/v3/changes/startPageToken",
+                          "GET");
+  auto request = http()->create(endpoint() + "/drive/v3/changes", "GET");
+  request->setParameter("pageToken", cursor);
+  request->setParameter("fields",
+                        "changes(fileId,removed,file(id,name,thumbnailLink,"
+                        "trashed,mimeType,iconLink,parents,size,modifiedTime,"
+                        "md5Checksum)),nextPageToken,newStartPageToken");
+  return request;
+}
+
 IItem::Pointer GoogleDrive::getItemDataResponse(std::istream& response) const {
   return toItem(util::json::from_stream(response));
 }
@@ -335,6 +524,27 @@ GeneralData GoogleDrive::getGeneralDataResponse(std::istream& response) const {
   return data;
 }
 
+ChangeData GoogleDrive::listChangesResponse(const IItem&, std::istream& stream,
+                                            bool& has_more) const {
+  auto response = util::json::from_stream(stream);
+  ChangeData result;
+  for (const auto& v : response["changes"]) {
+    if (v["removed"].asBool())
+      result.deleted_.push_back(v["fileId"].asString());
+    else
+      result.items_.push_back(toItem(v["file"]));
+  }
+  if (response.isMember("nextPageToken")) {
+    result.cursor_ = response["nextPageToken"].asString();
+    has_more = true;
+  } else if (response.isMember("newStartPageToken")) {
+    result.cursor_ = response["newStartPageToken"].asString();
+  } else {
+    result.cursor_ = response["startPageToken"].asString();
+  }
+  return result;
+}
+
 IHttpRequest::Pointer GoogleDrive::upload(const IItem& f,
                                           const std::string& url,
                                           const std::string& method,
@@ -342,14 +552,78 @@ IHttpRequest::Pointer GoogleDrive::upload(const IItem& f,
                                           std::ostream& prefix_stream,
                                           std::ostream& suffix_stream) const {
   const std::string separator = "fWoDm9QNn3v3Bq3bScUX";
-  const Item& item = static_cast<const Item&>(f);
   IHttpRequest::Pointer request = http()->create(url, method);
   request->setHeaderParameter("Content-Type",
                               "multipart/related; boundary=" + separator);
   request->setParameter("uploadType", "multipart");
+  request->setParameter("fields", UPLOAD_FIELDS);
+  prefix_stream << "--" << separator << "\r\n"
+                << "Content-Type: application/json; charset=UTF-8\r\n\r\n"
+                << util::json::to_string(uploadMetadata(f, method, filename))
+                << "\r\n"
+                << "--" << separator << "\r\n"
+                << "Content-Type: \r\n\r\n";
+  suffix_stream << "\r\n--" << separator << "--\r\n";
+  return request;
+}
+
+ICloudProvider::GetItemRequest::Pointer GoogleDrive::findFileAsync(
+    IItem::Pointer directory, const std::string& filename,
+    GetItemCallback callback) {
+  auto resolver = [=](Request<EitherError<IItem>>::Pointer r) {
+    r->request(
+        [=](util::Output) { return findFileRequest(*directory, filename); },
+        [=](EitherError<Response> e) {
+          if (e.left()) return r->done(e.left());
+          try {
+            std::string next_page_token;
+            auto list = listDirectoryResponse(*directory, e.right()->output(),
+                                              next_page_token);
+            if (list.empty()) return r->done(IItem::Pointer());
+            r->done(list.front());
+          } catch (const std::exception&) {
+            r->done(Error{IHttpRequest::Failure, e.right()->output().str()});
+          }
+        });
+  };
+  return std::make_shared<Request<EitherError<IItem>>>(shared_from_this(),
+                                                       callback, resolver)
+      ->run();
+}
+
+IHttpRequest::Pointer GoogleDrive::findFileRequest(
+    const IItem& directory, const std::string& filename) const {
+  std::string name;
+  for (char c : filename) {
+    if (c == '\'' || c == '\\') name += '\\';
+    name += c;
+  }
+  auto request = http()->create(endpoint() + "/drive/v3/files", "GET");
+  request->setParameter(
+      "q", util::Url::escape("name = '" + name + "' and '" + directory.id() +
+                             "' in parents and trashed = false"));
   request->setParameter("fields",
-                        "id,name,thumbnailLink,trashed,"
-                        "mimeType,iconLink,parents,size,modifiedTime");
+                        "files(id,name,thumbnailLink,trashed,mimeType,"
+                        "iconLink,parents,size,modifiedTime,md5Checksum)");
+  return request;
+}
+
+IHttpRequest::Pointer GoogleDrive::uploadSessionRequest(
+    const IItem& f, const std::string& url, const std::string& method,
+    const std::string& filename, uint64_t size, std::ostream& input) const {
+  IHttpRequest::Pointer request = http()->create(url, method);
+  request->setHeaderParameter("Content-Type",
+                              "application/json; charset=UTF-8");
+  request->setHeaderParameter("X-Upload-Content-Length", std::to_string(size));
+  request->setParameter("uploadType", "resumable");
+  request->setParameter("fields", UPLOAD_FIELDS);
+  input << util::json::to_string(uploadMetadata(f, method, filename));
+  return request;
+}
+
+Json::Value GoogleDrive::uploadMetadata(const IItem& f,
+                                        const std::string& method,
+                                        const std::string& filename) const {
   Json::Value request_data;
   auto it = filename.find_last_of('.');
   if (it != std::string::npos) {
@@ -358,15 +632,14 @@ IHttpRequest::Pointer GoogleDrive::upload(const IItem& f,
   }
   if (method == "POST") {
     request_data["name"] = filename;
-    request_data["parents"].append(item.id());
+    request_data["parents"].append(f.id());
   }
-  prefix_stream << "--" << separator << "\r\n"
-                << "Content-Type: application/json; charset=UTF-8\r\n\r\n"
-                << util::json::to_string(request_data) << "\r\n"
-                << "--" << separator << "\r\n"
-                << "Content-Type: \r\n\r\n";
-  suffix_stream << "\r\n--" << separator << "--\r\n";
-  return request;
+  return request_data;
+}
+
+bool GoogleDrive::check_existing() const {
+  auto lock = auth_lock();
+  return check_existing_;
 }
 
 bool GoogleDrive::isGoogleMimeType(const std::string& mime_type) const {
@@ -407,6 +680,8 @@ IItem::Pointer GoogleDrive::toItem(const Json::Value& v) const {
                               ? v["thumbnailLink"].asString()
                               : icon_link(v["iconLink"].asString()));
   item->set_mime_type(v["mimeType"].asString());
+  if (v.isMember("md5Checksum"))
+    item->set_hash(IItem::HashType::MD5, v["md5Checksum"].asString());
   std::vector<std::string> parents;
   for (const auto& id : v["parents"]) parents.push_back(id.asString());
   item->set_parents(parents);
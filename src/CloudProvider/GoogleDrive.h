@@ -34,15 +34,22 @@ namespace cloudstorage {
 class GoogleDrive : public CloudProvider {
  public:
   GoogleDrive();
+  void initialize(InitData&&) override;
   std::string name() const override;
+  IItem::HashType hashType() const override;
   std::string endpoint() const override;
 
   ICloudProvider::DownloadFileRequest::Pointer downloadFileAsync(
       IItem::Pointer file, IDownloadFileCallback::Pointer callback,
       Range range) override;
+  UploadFileRequest::Pointer resumeUploadAsync(
+      const std::string& state, IUploadFileCallback::Pointer) override;
   UploadFileRequest::Pointer uploadFileAsync(
       IItem::Pointer, const std::string&,
       IUploadFileCallback::Pointer) override;
+  GetItemRequest::Pointer findFileAsync(IItem::Pointer directory,
+                                        const std::string& filename,
+                                        GetItemCallback) override;
 
   IHttpRequest::Pointer getItemDataRequest(
       const std::string&, std::ostream& input_stream) const override;
@@ -63,9 +70,14 @@ class GoogleDrive : public CloudProvider {
                                                std::ostream&) const override;
   IHttpRequest::Pointer moveItemRequest(const IItem&, const IItem&,
                                         std::ostream&) const override;
+  IHttpRequest::Pointer copyItemRequest(const IItem&, const IItem&,
+                                        std::ostream&) const override;
   IHttpRequest::Pointer renameItemRequest(const IItem&, const std::string& name,
                                           std::ostream&) const override;
   IHttpRequest::Pointer getGeneralDataRequest(std::ostream&) const override;
+  IHttpRequest::Pointer listChangesRequest(const IItem&,
+                                           const std::string& cursor,
+                                           std::ostream&) const override;
 
   IItem::Pointer getItemDataResponse(std::istream& response) const override;
   std::string getItemUrlResponse(const IItem& item,
@@ -74,12 +86,24 @@ class GoogleDrive : public CloudProvider {
   IItem::List listDirectoryResponse(
       const IItem&, std::istream&, std::string& next_page_token) const override;
   GeneralData getGeneralDataResponse(std::istream& response) const override;
+  ChangeData listChangesResponse(const IItem&, std::istream&,
+                                 bool& has_more) const override;
 
   IHttpRequest::Pointer upload(const IItem& f, const std::string& url,
                                const std::string& method,
                                const std::string& filename,
                                std::ostream& prefix_stream,
                                std::ostream& suffix_stream) const;
+  IHttpRequest::Pointer findFileRequest(const IItem& directory,
+                                        const std::string& filename) const;
+  IHttpRequest::Pointer uploadSessionRequest(const IItem& f,
+                                             const std::string& url,
+                                             const std::string& method,
+                                             const std::string& filename,
+                                             uint64_t size,
+                                             std::ostream& input) const;
+  Json::Value uploadMetadata(const IItem& f, const std::string& method,
+                             const std::string& filename) const;
 
   bool isGoogleMimeType(const std::string& mime_type) const;
   IItem::FileType toFileType(const std::string& mime_type) const;
@@ -99,6 +123,11 @@ class GoogleDrive : public CloudProvider {
         std::istream&) const override;
     Token::Pointer refreshTokenResponse(std::istream&) const override;
   };
+
+ private:
+  bool check_existing() const;
+
+  bool check_existing_;
 };
 
 }  // namespace cloudstorage
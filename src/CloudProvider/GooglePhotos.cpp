@@ -41,6 +41,8 @@ const auto PHOTOS_ID = "photos";
 const auto PHOTOS_NAME = "Photos";
 const auto SHARED_ID = "shared";
 const auto SHARED_NAME = "Shared with me";
+// Base urls are valid for an hour.
+const auto URL_LIFETIME = std::chrono::minutes(50);
 
 ICloudProvider::GeneralDataRequest::Pointer getGeneralDataUsingOpenId(
     CloudProvider *p, GeneralDataCallback callback) {
@@ -104,6 +106,8 @@ ICloudProvider::OperationSet GooglePhotos::supportedOperations() const {
          DownloadFile | CreateDirectory;
 }
 
+std::chrono::seconds GooglePhotos::urlLifetime() const { return URL_LIFETIME; }
+
 IHttpRequest::Pointer GooglePhotos::getItemDataRequest(
     const std::string &id_str, std::ostream &) const {
   if (id_str == rootDirectory()->id() || id_str == ALBUMS_ID ||
@@ -387,7 +391,8 @@ ICloudProvider::DownloadFileRequest::Pointer GooglePhotos::downloadFromUrl(
     IDownloadFileCallback::Pointer callback) {
   return std::make_shared<cloudstorage::DownloadFileRequest>(
              shared_from_this(), item, callback, FullRange,
-             [=](const IItem &, std::ostream &) { return http()->create(url); })
+             [=](const IItem &, std::ostream &) { return http()->create(url); },
+             false)
       ->run();
 }
 
@@ -36,6 +36,7 @@ class GooglePhotos : public CloudProvider {
   bool reauthorize(int code,
                    const IHttpRequest::HeaderParameters&) const override;
   OperationSet supportedOperations() const override;
+  std::chrono::seconds urlLifetime() const override;
 
   IHttpRequest::Pointer getItemDataRequest(
       const std::string&, std::ostream& input_stream) const override;
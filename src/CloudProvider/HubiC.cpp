@@ -27,7 +27,22 @@
 
 namespace cloudstorage {
 
-HubiC::HubiC() : CloudProvider(util::make_unique<Auth>()) {}
+HubiC::HubiC()
+    : CloudProvider(util::make_unique<Auth>()),
+      concurrency_(RecursiveRequest<EitherError<void>>::DEFAULT_CONCURRENCY) {}
+
+void HubiC::initialize(InitData&& data) {
+  setWithHint(data.hints_, "recursive_concurrency", [=](std::string v) {
+    concurrency_ = std::max<size_t>(std::strtoull(v.c_str(), nullptr, 10), 1);
+  });
+  CloudProvider::initialize(std::move(data));
+}
+
+ICloudProvider::Hints HubiC::hints() const {
+  auto hints = CloudProvider::hints();
+  hints.insert({{"recursive_concurrency", std::to_string(concurrency_)}});
+  return hints;
+}
 
 std::string HubiC::name() const { return "hubic"; }
 
@@ -194,7 +209,7 @@ ICloudProvider::MoveItemRequest::Pointer HubiC::moveItemAsync(
         });
   };
   return std::make_shared<Request>(shared_from_this(), source, callback,
-                                   visitor)
+                                   visitor, concurrency_)
       ->run();
 }
 
@@ -231,7 +246,8 @@ ICloudProvider::MoveItemRequest::Pointer HubiC::renameItemAsync(
               });
         });
   };
-  return std::make_shared<Request>(shared_from_this(), root, callback, visitor)
+  return std::make_shared<Request>(shared_from_this(), root, callback, visitor,
+                                   concurrency_)
       ->run();
 }
 
@@ -253,7 +269,8 @@ ICloudProvider::DeleteItemRequest::Pointer HubiC::deleteItemAsync(
             callback(nullptr);
         });
   };
-  return std::make_shared<Request>(shared_from_this(), item, callback, visitor)
+  return std::make_shared<Request>(shared_from_this(), item, callback, visitor,
+                                   concurrency_)
       ->run();
 }
 
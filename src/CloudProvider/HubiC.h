@@ -32,6 +32,9 @@ class HubiC : public CloudProvider {
  public:
   HubiC();
 
+  void initialize(InitData&&) override;
+  Hints hints() const override;
+
   std::string name() const override;
   std::string endpoint() const override;
   void authorizeRequest(IHttpRequest& request) const override;
@@ -101,6 +104,7 @@ class HubiC : public CloudProvider {
 
   std::string openstack_endpoint_;
   std::string openstack_token_;
+  size_t concurrency_;
 };
 
 }  // namespace cloudstorage
@@ -321,9 +321,8 @@ LocalDrive::GeneralDataRequest::Pointer LocalDrive::getGeneralDataAsync(
       });
 }
 
-LocalDrive::GetItemUrlRequest::Pointer LocalDrive::getFileDaemonUrlAsync(
-    IItem::Pointer item, GetItemUrlCallback callback) {
-  return getItemUrlAsync(item, callback);
+std::string LocalDrive::localFilePath(const std::string &id) const {
+  return id == rootDirectory()->id() ? "" : id;
 }
 
 bool LocalDrive::unpackCredentials(const std::string &code) {
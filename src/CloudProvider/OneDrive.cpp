@@ -28,10 +28,13 @@
 
 #include <iostream>
 #include "Request/Request.h"
+#include "Utility/ChunkReader.h"
 #include "Utility/Item.h"
 #include "Utility/Utility.h"
 
-const uint32_t CHUNK_SIZE = 60 * 1024 * 1024;
+// upload session fragments must be a multiple of 320 KiB, up to 60 MiB
+const uint32_t CHUNK_SIZE_UNIT = 320 * 1024;
+const uint32_t MAX_CHUNK_SIZE = 192 * CHUNK_SIZE_UNIT;
 using namespace std::placeholders;
 
 namespace cloudstorage {
@@ -39,44 +42,56 @@ namespace cloudstorage {
 namespace {
 void upload(const Request<EitherError<IItem>>::Pointer& r,
             const std::string& upload_url, uint64_t sent,
-            IUploadFileCallback* callback, const Json::Value& response) {
-  auto size = callback->size();
-  auto length = std::make_shared<uint64_t>(0);
-  if (sent >= size)
-    return r->done(
-        static_cast<OneDrive*>(r->provider().get())->toItem(response));
+            const ChunkReader::Pointer& reader, IUploadFileCallback* callback,
+            const Json::Value& response) {
+  auto size = reader->size();
+  auto length = std::make_shared<uint32_t>(0);
+  auto provider = static_cast<OneDrive*>(r->provider().get());
+  if (sent >= size) {
+    auto item = provider->toItem(response);
+    if (!reader->verify(*item))
+      return r->done(
+          Error{IHttpRequest::Failure, util::Error::CONTENT_HASH_MISMATCH});
+    return r->done(item);
+  }
+  Json::Value session;
+  session["upload_url"] = upload_url;
+  callback->uploadSession(
+      provider->uploadSessionToString(session, sent, size));
   r->send(
-      [=](util::Output stream) {
-        std::vector<char> buffer(CHUNK_SIZE);
-        *length = callback->putData(buffer.data(), CHUNK_SIZE, sent);
+      [=](util::Output) {
         auto request = r->provider()->http()->create(upload_url, "PUT");
         std::stringstream content_range;
         content_range << "bytes " << sent << "-" << sent + *length - 1 << "/"
                       << size;
         request->setHeaderParameter("Content-Range", content_range.str());
-        stream->write(buffer.data(), *length);
         return request;
       },
       [=](EitherError<Response> e) {
         if (e.left()) return r->done(e.left());
         try {
           auto json = util::json::from_stream(e.right()->output());
-          upload(r, upload_url, sent + *length, callback, json);
+          upload(r, upload_url, sent + *length, reader, callback, json);
         } catch (const Json::Exception&) {
           r->done(Error{IHttpRequest::Failure, e.right()->output().str()});
         }
       },
-      [] { return std::make_shared<std::stringstream>(); },
+      [=] { return reader->read(sent, *length); },
       std::make_shared<std::stringstream>(), nullptr,
       [=](uint64_t, uint64_t now) { callback->progress(size, sent + now); },
       true);
 }
 }  // namespace
 
-OneDrive::OneDrive() : CloudProvider(util::make_unique<Auth>()) {}
+OneDrive::OneDrive()
+    : CloudProvider(util::make_unique<Auth>()), chunk_size_(MAX_CHUNK_SIZE) {}
 
 std::string OneDrive::name() const { return "onedrive"; }
 
+IItem::HashType OneDrive::hashType() const {
+  return IItem::HashType::QuickXorHash;
+}
+
 std::string OneDrive::endpoint() const {
   auto lock = auth_lock();
   return endpoint_;
@@ -87,12 +102,19 @@ void OneDrive::initialize(ICloudProvider::InitData&& d) {
     auto lock = auth_lock();
     endpoint_ = v;
   });
+  setWithHint(d.hints_, "upload_chunk_size", [=](std::string v) {
+    auto size = std::strtoull(v.c_str(), nullptr, 10) / CHUNK_SIZE_UNIT;
+    chunk_size_ = static_cast<uint32_t>(
+        std::min<uint64_t>(std::max<uint64_t>(size, 1) * CHUNK_SIZE_UNIT,
+                           MAX_CHUNK_SIZE));
+  });
   CloudProvider::initialize(std::move(d));
 }
 
 ICloudProvider::Hints OneDrive::hints() const {
   auto hints = CloudProvider::hints();
-  hints.insert({{"endpoint", endpoint()}});
+  hints.insert({{"endpoint", endpoint()},
+                {"upload_chunk_size", std::to_string(chunk_size_)}});
   return hints;
 }
 
@@ -157,8 +179,10 @@ ICloudProvider::UploadFileRequest::Pointer OneDrive::uploadFileAsync(
                      try {
                        auto response =
                            util::json::from_stream(e.right()->output());
-                       upload(r, response["uploadUrl"].asString(), 0, callback,
-                              response);
+                       upload(r, response["uploadUrl"].asString(), 0,
+                              std::make_shared<ChunkReader>(cb, chunk_size_,
+                                                            hashType()),
+                              callback, response);
                      } catch (const Json::Exception& e) {
                        r->done(Error{IHttpRequest::Failure, e.what()});
                      }
@@ -167,6 +191,71 @@ ICloudProvider::UploadFileRequest::Pointer OneDrive::uploadFileAsync(
       ->run();
 }
 
+ICloudProvider::UploadFileRequest::Pointer OneDrive::resumeUploadAsync(
+    const std::string& state, IUploadFileCallback::Pointer cb) {
+  auto callback = cb.get();
+  auto session = uploadSessionFromString(state, cb->size());
+  return std::make_shared<Request<EitherError<IItem>>>(
+             shared_from_this(), [=](EitherError<IItem> e) { cb->done(e); },
+             [=](Request<EitherError<IItem>>::Pointer r) {
+               if (session.isNull())
+                 return r->done(Error{IHttpRequest::Bad,
+                                      util::Error::INVALID_UPLOAD_SESSION});
+               auto upload_url = session["upload_url"].asString();
+               r->send(
+                   [=](util::Output) {
+                     return http()->create(upload_url, "GET");
+                   },
+                   [=](EitherError<Response> e) {
+                     if (e.left()) return r->done(e.left());
+                     try {
+                       auto response =
+                           util::json::from_stream(e.right()->output());
+                       auto ranges = response["nextExpectedRanges"];
+                       auto offset =
+                           ranges.empty()
+                               ? session["offset"].asUInt64()
+                               : std::stoull(ranges[0].asString());
+                       upload(r, upload_url, offset,
+                              std::make_shared<ChunkReader>(cb, chunk_size_,
+                                                            hashType()),
+                              callback, response);
+                     } catch (const std::exception& e) {
+                       r->done(Error{IHttpRequest::Failure, e.what()});
+                     }
+                   });
+             })
+      ->run();
+}
+
+ICloudProvider::GetItemRequest::Pointer OneDrive::findFileAsync(
+    IItem::Pointer directory, const std::string& filename,
+    GetItemCallback callback) {
+  auto resolver = [=](Request<EitherError<IItem>>::Pointer r) {
+    r->request(
+        [=](util::Output input) {
+          return getItemDataRequest(
+              directory->id() + ":/" + util::Url::escape(filename) + ":",
+              *input);
+        },
+        [=](EitherError<Response> e) {
+          if (e.left()) {
+            if (e.left()->code_ == IHttpRequest::NotFound)
+              return r->done(IItem::Pointer());
+            return r->done(e.left());
+          }
+          try {
+            r->done(getItemDataResponse(e.right()->output()));
+          } catch (const std::exception&) {
+            r->done(Error{IHttpRequest::Failure, e.right()->output().str()});
+          }
+        });
+  };
+  return std::make_shared<Request<EitherError<IItem>>>(shared_from_this(),
+                                                       callback, resolver)
+      ->run();
+}
+
 ICloudProvider::GeneralDataRequest::Pointer OneDrive::getGeneralDataAsync(
     GeneralDataCallback callback) {
   auto resolver = [=](Request<EitherError<GeneralData>>::Pointer r) {
@@ -202,7 +291,7 @@ IHttpRequest::Pointer OneDrive::getItemDataRequest(const std::string& id,
   IHttpRequest::Pointer request =
       http()->create(endpoint() + "/drive/items/" + id, "GET");
   request->setParameter("select",
-                        "name,folder,audio,image,photo,video,id,size,"
+                        "name,folder,file,audio,image,photo,video,id,size,"
                         "lastModifiedDateTime,thumbnails,@content.downloadUrl");
   request->setParameter("expand", "thumbnails");
   return request;
@@ -214,7 +303,7 @@ IHttpRequest::Pointer OneDrive::listDirectoryRequest(
   auto request = http()->create(
       endpoint() + "/drive/items/" + item.id() + "/children", "GET");
   request->setParameter("select",
-                        "name,folder,audio,image,photo,video,id,size,"
+                        "name,folder,file,audio,image,photo,video,id,size,"
                         "lastModifiedDateTime,thumbnails,@content.downloadUrl");
   request->setParameter("expand", "thumbnails");
   return request;
@@ -272,6 +361,16 @@ IHttpRequest::Pointer OneDrive::renameItemRequest(const IItem& item,
   return request;
 }
 
+IHttpRequest::Pointer OneDrive::listChangesRequest(const IItem& item,
+                                                   const std::string& cursor,
+                                                   std::ostream&) const {
+  if (!cursor.empty()) return http()->create(cursor, "GET");
+  auto request = http()->create(
+      endpoint() + "/drive/items/" + item.id() + "/delta", "GET");
+  request->setParameter("token", "latest");
+  return request;
+}
+
 IItem::Pointer OneDrive::getItemDataResponse(std::istream& response) const {
   return toItem(util::json::from_stream(response));
 }
@@ -291,6 +390,9 @@ IItem::Pointer OneDrive::toItem(const Json::Value& v) const {
       util::parse_time(v["lastModifiedDateTime"].asString()), type);
   item->set_url(v["@microsoft.graph.downloadUrl"].asString());
   item->set_thumbnail_url(v["thumbnails"][0]["small"]["url"].asString());
+  if (v["file"]["hashes"].isMember("quickXorHash"))
+    item->set_hash(IItem::HashType::QuickXorHash,
+                   v["file"]["hashes"]["quickXorHash"].asString());
   return std::move(item);
 }
 
@@ -304,6 +406,25 @@ IItem::List OneDrive::listDirectoryResponse(
   return result;
 }
 
+ChangeData OneDrive::listChangesResponse(const IItem&, std::istream& stream,
+                                         bool& has_more) const {
+  auto response = util::json::from_stream(stream);
+  ChangeData result;
+  for (const auto& v : response["value"]) {
+    if (v.isMember("deleted"))
+      result.deleted_.push_back(v["id"].asString());
+    else
+      result.items_.push_back(toItem(v));
+  }
+  if (response.isMember("@odata.nextLink")) {
+    result.cursor_ = response["@odata.nextLink"].asString();
+    has_more = true;
+  } else {
+    result.cursor_ = response["@odata.deltaLink"].asString();
+  }
+  return result;
+}
+
 void OneDrive::Auth::initialize(IHttp* http, IHttpServerFactory* factory) {
   cloudstorage::Auth::initialize(http, factory);
   if (client_id().empty()) {
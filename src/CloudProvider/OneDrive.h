@@ -36,6 +36,7 @@ class OneDrive : public CloudProvider {
   OneDrive();
 
   std::string name() const override;
+  IItem::HashType hashType() const override;
   std::string endpoint() const override;
 
   IItem::Pointer toItem(const Json::Value&) const;
@@ -47,10 +48,15 @@ class OneDrive : public CloudProvider {
   Hints hints() const override;
 
   AuthorizeRequest::Pointer authorizeAsync() override;
+  UploadFileRequest::Pointer resumeUploadAsync(
+      const std::string& state, IUploadFileCallback::Pointer) override;
   UploadFileRequest::Pointer uploadFileAsync(
       IItem::Pointer, const std::string& filename,
       IUploadFileCallback::Pointer) override;
   GeneralDataRequest::Pointer getGeneralDataAsync(GeneralDataCallback) override;
+  GetItemRequest::Pointer findFileAsync(IItem::Pointer directory,
+                                        const std::string& filename,
+                                        GetItemCallback) override;
 
   IHttpRequest::Pointer getItemDataRequest(
       const std::string&, std::ostream& input_stream) const override;
@@ -68,10 +74,15 @@ class OneDrive : public CloudProvider {
                                         std::ostream&) const override;
   IHttpRequest::Pointer renameItemRequest(const IItem&, const std::string& name,
                                           std::ostream&) const override;
+  IHttpRequest::Pointer listChangesRequest(const IItem&,
+                                           const std::string& cursor,
+                                           std::ostream&) const override;
 
   IItem::List listDirectoryResponse(const IItem&, std::istream&,
                                     std::string&) const override;
   IItem::Pointer getItemDataResponse(std::istream& response) const override;
+  ChangeData listChangesResponse(const IItem&, std::istream&,
+                                 bool& has_more) const override;
 
  private:
   class Auth : public cloudstorage::Auth {
@@ -90,6 +101,7 @@ class OneDrive : public CloudProvider {
   };
 
   std::string endpoint_;
+  uint32_t chunk_size_;
 };
 
 }  // namespace cloudstorage
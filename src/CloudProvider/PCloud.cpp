@@ -200,6 +200,37 @@ IHttpRequest::Pointer PCloud::getGeneralDataRequest(std::ostream&) const {
   return http()->create(endpoint() + "/userinfo");
 }
 
+IHttpRequest::Pointer PCloud::listChangesRequest(const IItem&,
+                                                 const std::string& cursor,
+                                                 std::ostream&) const {
+  auto request = http()->create(endpoint() + "/diff");
+  if (cursor.empty())
+    request->setParameter("last", "0");
+  else
+    request->setParameter("diffid", cursor);
+  request->setParameter("timeformat", "timestamp");
+  return request;
+}
+
+ChangeData PCloud::listChangesResponse(const IItem&, std::istream& response,
+                                       bool&) const {
+  auto json = util::json::from_stream(response);
+  ChangeData result;
+  for (auto&& v : json["entries"]) {
+    auto event = v["event"].asString();
+    if (!v.isMember("metadata") ||
+        (event.find("file") == std::string::npos &&
+         event.find("folder") == std::string::npos))
+      continue;
+    if (event == "deletefile" || event == "deletefolder")
+      result.deleted_.push_back(toItem(v["metadata"])->id());
+    else
+      result.items_.push_back(toItem(v["metadata"]));
+  }
+  result.cursor_ = json["diffid"].asString();
+  return result;
+}
+
 IItem::List PCloud::listDirectoryResponse(const IItem&, std::istream& response,
                                           std::string&) const {
   auto json = util::json::from_stream(response);
@@ -208,6 +239,33 @@ IItem::List PCloud::listDirectoryResponse(const IItem&, std::istream& response,
   return result;
 }
 
+IHttpRequest::Pointer PCloud::walkTreeRequest(const IItem& item,
+                                              const std::string&,
+                                              std::ostream&) const {
+  auto req = http()->create(endpoint() + "/listfolder");
+  req->setParameter("folderid", FileId(item.id()).id_);
+  req->setParameter("recursive", "1");
+  req->setParameter("timeformat", "timestamp");
+  return req;
+}
+
+CloudProvider::TreeEntries PCloud::walkTreeResponse(const IItem&,
+                                                    std::istream& response,
+                                                    std::string&) const {
+  TreeEntries result;
+  std::function<void(const std::string&, const Json::Value&)> add =
+      [&](const std::string& path, const Json::Value& folder) {
+        for (auto&& v : folder["contents"]) {
+          auto item = toItem(v);
+          auto item_path = path + item->filename();
+          result.push_back({item_path, std::move(item)});
+          if (v["isfolder"].asBool()) add(item_path + "/", v);
+        }
+      };
+  add("", util::json::from_stream(response)["metadata"]);
+  return result;
+}
+
 IItem::Pointer PCloud::toItem(const Json::Value& v) const {
   auto item = util::make_unique<Item>(
       v["name"].asString(),
@@ -64,6 +64,12 @@ class PCloud : public CloudProvider {
   IHttpRequest::Pointer renameItemRequest(const IItem&, const std::string& name,
                                           std::ostream&) const override;
   IHttpRequest::Pointer getGeneralDataRequest(std::ostream&) const override;
+  IHttpRequest::Pointer listChangesRequest(const IItem&,
+                                           const std::string& cursor,
+                                           std::ostream&) const override;
+  IHttpRequest::Pointer walkTreeRequest(const IItem&,
+                                        const std::string& page_token,
+                                        std::ostream&) const override;
 
   IItem::List listDirectoryResponse(
       const IItem&, std::istream&, std::string& next_page_token) const override;
@@ -75,6 +81,10 @@ class PCloud : public CloudProvider {
                                     const std::string& filename, uint64_t,
                                     std::istream& response) const override;
   GeneralData getGeneralDataResponse(std::istream& response) const override;
+  ChangeData listChangesResponse(const IItem&, std::istream&,
+                                 bool& has_more) const override;
+  TreeEntries walkTreeResponse(const IItem&, std::istream&,
+                               std::string& next_page_token) const override;
 
   IItem::Pointer toItem(const Json::Value&) const;
 
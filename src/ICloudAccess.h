@@ -54,6 +54,8 @@ class CLOUDSTORAGE_API ICloudAccess {
  public:
   using Pointer = std::unique_ptr<ICloudAccess>;
   using ProgressCallback = std::function<void(uint64_t total, uint64_t now)>;
+  using WalkTreeCallback =
+      std::function<void(const std::string& path, IItem::Pointer item)>;
 
   virtual ~ICloudAccess() = default;
 
@@ -77,6 +79,21 @@ class CLOUDSTORAGE_API ICloudAccess {
                                              const std::string& new_name) = 0;
   virtual Promise<PageData> listDirectoryPage(IItem::Pointer item,
                                               const std::string& token) = 0;
+  virtual Promise<ChangeData> listChanges(IItem::Pointer item,
+                                          const std::string& cursor) = 0;
+
+  /**
+   * Enumerates the subtree of root; callback is invoked on the event loop for
+   * every item found.
+   */
+  virtual Promise<> walkTree(IItem::Pointer root, WalkTreeCallback callback,
+                             WalkTreeOptions options = WalkTreeOptions()) = 0;
+
+  /**
+   * Looks up items by filename in the local index, which is filled with items
+   * returned by the other methods of this object.
+   */
+  virtual Promise<IItem::List> search(const std::string& query) = 0;
   virtual Promise<IItem::Pointer> uploadFile(
       IItem::Pointer parent, const std::string& filename,
       const std::shared_ptr<ICloudUploadCallback>&) = 0;
@@ -88,6 +105,9 @@ class CLOUDSTORAGE_API ICloudAccess {
   virtual Promise<> generateThumbnail(
       IItem::Pointer file, const std::shared_ptr<ICloudDownloadCallback>&) = 0;
 
+  virtual void dumpSearchIndex(std::ostream&) const = 0;
+  virtual bool loadSearchIndex(std::istream&) = 0;
+
   static std::unique_ptr<ICloudUploadCallback> streamUploader(
       const std::shared_ptr<std::istream>& stream,
       const ProgressCallback& progress = nullptr);
@@ -54,8 +54,11 @@ class CLOUDSTORAGE_API ICloudProvider {
   using DeleteItemRequest = IRequest<EitherError<void>>;
   using CreateDirectoryRequest = IRequest<EitherError<IItem>>;
   using MoveItemRequest = IRequest<EitherError<IItem>>;
+  using CopyItemRequest = IRequest<EitherError<IItem>>;
   using RenameItemRequest = IRequest<EitherError<IItem>>;
   using GeneralDataRequest = IRequest<EitherError<GeneralData>>;
+  using ListChangesRequest = IRequest<EitherError<ChangeData>>;
+  using WalkTreeRequest = IRequest<EitherError<void>>;
 
   using OperationSet = uint32_t;
 
@@ -143,6 +146,12 @@ class CLOUDSTORAGE_API ICloudProvider {
      */
     IThreadPool::Pointer thread_pool_;
 
+    /**
+     * Provides thread pool used for hashing file contents; if not given, one
+     * is created the first time a file has to be hashed.
+     */
+    IThreadPool::Pointer hash_thread_pool_;
+
     /**
      * Various hints which can be retrieved by some previous run with
      * ICloudProvider::hints; providing them may speed up the authorization
@@ -163,6 +172,17 @@ class CLOUDSTORAGE_API ICloudProvider {
      *  - success_page (page to be displayed when library was authorized
      *    successfully)
      *  - error_page (page to be displayed when library authorization failed)
+     *  - upload_part_size, upload_concurrency (amazon s3's multipart upload
+     *    part size in bytes and count of parts uploaded at once)
+     *  - upload_chunk_size (size in bytes of upload session chunks used by
+     *    onedrive and dropbox)
+     *  - upload_check_existing (google drive; "false" skips looking up a
+     *    file with the same name to overwrite, every upload creates a new
+     *    file)
+     *  - file_cache_size, file_item_cache_size (file daemon's cache of file
+     *    data in bytes and of item metadata in entries)
+     *  - recursive_concurrency (hubic; count of objects moved, renamed or
+     *    deleted at once)
      */
     Hints hints_;
   };
@@ -293,6 +313,28 @@ class CLOUDSTORAGE_API ICloudProvider {
       IItem::Pointer item, IDownloadFileCallback::Pointer,
       Range = FullRange) = 0;
 
+  /**
+   * Downloads the item with several ranged requests running at once, which
+   * helps on links where a single connection can't reach full bandwidth.
+   * Data is passed to the callback in order, unless it accepts it out of
+   * order. Segment size and count of concurrent segments adapt to measured
+   * throughput; files of unknown size or not larger than one segment are
+   * downloaded as usual. A failed segment is retried once, continuing from
+   * the data already received.
+   *
+   * @param item item to be downloaded
+   *
+   * @param callback receives file's data
+   *
+   * @param options initial segment size, max concurrency and reordering
+   * buffer size
+   *
+   * @return object representing the pending request
+   */
+  virtual DownloadFileRequest::Pointer downloadFileSegmentedAsync(
+      IItem::Pointer item, IDownloadFileCallback::Pointer callback,
+      SegmentedDownloadOptions options = SegmentedDownloadOptions()) = 0;
+
   /**
    * Uploads the file provided by callback.
    *
@@ -307,6 +349,38 @@ class CLOUDSTORAGE_API ICloudProvider {
       IItem::Pointer parent, const std::string& filename,
       IUploadFileCallback::Pointer) = 0;
 
+  /**
+   * Continues an upload interrupted e.g. by a restart of the application;
+   * the offset committed by the server is queried and the upload continues
+   * from there. Supported by google drive, onedrive and dropbox for uploads
+   * large enough to be sent in chunks.
+   *
+   * @param state upload session reported by
+   * IUploadFileCallback::uploadSession
+   *
+   * @param callback provides the same file as the interrupted upload
+   *
+   * @return object representing the pending request
+   */
+  virtual UploadFileRequest::Pointer resumeUploadAsync(
+      const std::string& state, IUploadFileCallback::Pointer callback) = 0;
+
+  /**
+   * Uploads file, unless the parent already contains a file with the same
+   * name, size and content hash. The local hash is computed by reading the
+   * data once from the callback before anything is sent; if it matches, the
+   * request completes with the existing item. Behaves like uploadFileAsync
+   * for providers which don't report content hashes.
+   *
+   * @param parent
+   * @param filename
+   * @param callback
+   * @return object representing the pending request
+   */
+  virtual UploadFileRequest::Pointer uploadFileIfChangedAsync(
+      IItem::Pointer parent, const std::string& filename,
+      IUploadFileCallback::Pointer callback) = 0;
+
   /**
    * Retrieves IItem object from its id. That's the preferred way of updating
    * the IItem structure; IItem caches some data(e.g. thumbnail url or file url)
@@ -376,6 +450,28 @@ class CLOUDSTORAGE_API ICloudProvider {
       IItem::Pointer source, IItem::Pointer destination,
       MoveItemCallback callback = [](const EitherError<IItem>&) {}) = 0;
 
+  /**
+   * Copies item, possibly to a different provider. When both providers are
+   * the same account and the provider can copy on its own, no data goes
+   * through the client. Otherwise files are streamed from the download
+   * straight into the upload through a bounded buffer and directories are
+   * recreated with their contents copied a few items at a time.
+   *
+   * @param source item to be copied
+   *
+   * @param destination provider to copy to, may be this one
+   *
+   * @param parent destination directory
+   *
+   * @param callback called with the copied item when finished
+   *
+   * @return object representing the pending request
+   */
+  virtual CopyItemRequest::Pointer copyItemAsync(
+      IItem::Pointer source, std::shared_ptr<ICloudProvider> destination,
+      IItem::Pointer parent,
+      CopyItemCallback callback = [](const EitherError<IItem>&) {}) = 0;
+
   /**
    * Renames item.
    *
@@ -430,6 +526,27 @@ class CLOUDSTORAGE_API ICloudProvider {
       IItem::Pointer item, const std::string& filename,
       DownloadFileCallback callback = [](const EitherError<void>&) {}) = 0;
 
+  /**
+   * Downloads the item straight into a file. Data is written at its offset
+   * without going through a stream and space for the whole file is reserved
+   * upfront where supported.
+   *
+   * @param item item to be downloaded
+   *
+   * @param path path at which the downloaded file will be saved
+   *
+   * @param callback called when done
+   *
+   * @param options whether to resume from the length of an existing file, to
+   * use direct io and to download several segments at once
+   *
+   * @return object representing the pending request
+   */
+  virtual DownloadFileRequest::Pointer downloadToFileAsync(
+      IItem::Pointer item, const std::string& path,
+      DownloadFileCallback callback,
+      DownloadToFileOptions options = DownloadToFileOptions()) = 0;
+
   /**
    * Simplified version of getThumbnailAsync.
    *
@@ -470,6 +587,43 @@ class CLOUDSTORAGE_API ICloudProvider {
   virtual GetItemUrlRequest::Pointer getFileDaemonUrlAsync(
       IItem::Pointer item,
       GetItemUrlCallback = [](const EitherError<std::string>&) {}) = 0;
+
+  /**
+   * Lists changes which happened since the cursor was obtained. Providers with
+   * a native change feed (google, dropbox, onedrive, box, pcloud) may report
+   * changes from the whole account, other providers compare listings of the
+   * directory's direct children.
+   *
+   * @param directory directory to be watched
+   *
+   * @param cursor cursor returned by the previous call, empty to obtain the
+   * initial cursor; no changes are reported then
+   *
+   * @param callback called when done
+   *
+   * @return object representing the pending request
+   */
+  virtual ListChangesRequest::Pointer listChangesAsync(
+      IItem::Pointer directory, const std::string& cursor = "",
+      ListChangesCallback = [](const EitherError<ChangeData>&) {}) = 0;
+
+  /**
+   * Enumerates all items below the root directory. Directories are listed
+   * concurrently, or with a single recursive listing if the provider supports
+   * one, and items are reported as soon as they are found.
+   *
+   * @param root directory to start from
+   *
+   * @param callback receives found items and is notified when the walk is
+   * finished
+   *
+   * @param options depth, concurrency and subtree filter
+   *
+   * @return object representing the pending request
+   */
+  virtual WalkTreeRequest::Pointer walkTreeAsync(
+      IItem::Pointer root, IWalkTreeCallback::Pointer callback,
+      WalkTreeOptions options = WalkTreeOptions()) = 0;
 };
 
 }  // namespace cloudstorage
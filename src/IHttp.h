@@ -54,10 +54,12 @@ class CLOUDSTORAGE_API IHttpRequest {
   static constexpr int Partial = 206;
   static constexpr int MultiStatus = 207;
   static constexpr int PermamentRedirect = 301;
+  static constexpr int NotModified = 304;
   static constexpr int Bad = 400;
   static constexpr int Unauthorized = 401;
   static constexpr int Forbidden = 403;
   static constexpr int NotFound = 404;
+  static constexpr int Conflict = 409;
   static constexpr int RangeInvalid = 416;
   static constexpr int InternalServerError = 500;
   static constexpr int ServiceUnavailable = 503;
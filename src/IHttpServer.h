@@ -79,6 +79,21 @@ class CLOUDSTORAGE_API IHttpServer {
     virtual IResponse::Pointer response(
         int code, const IResponse::Headers&, int64_t size,
         IResponse::ICallback::Pointer) const = 0;
+
+    /**
+     * Creates response which sends size bytes of the local file at path,
+     * starting at offset, without copying them through user space.
+     *
+     * @return nullptr if the server can't send files directly, response
+     * should be used instead then
+     */
+    virtual IResponse::Pointer file_response(int /*code*/,
+                                             const IResponse::Headers&,
+                                             const std::string& /*path*/,
+                                             uint64_t /*offset*/,
+                                             uint64_t /*size*/) const {
+      return nullptr;
+    }
   };
 
   class ICallback {
@@ -97,6 +112,37 @@ class CLOUDSTORAGE_API IHttpServerFactory {
  public:
   using Pointer = std::unique_ptr<IHttpServerFactory>;
 
+  /**
+   * Tuning of the servers created by the default factory.
+   */
+  struct Options {
+    static constexpr size_t DefaultBlockSize = 256 * 1024;
+    static constexpr uint32_t DefaultThreadCount = 4;
+
+    /**
+     * Maximum amount of data requested from IResponse::ICallback::putData at
+     * once.
+     */
+    size_t block_size_ = DefaultBlockSize;
+
+    /**
+     * Number of threads serving connections.
+     */
+    uint32_t thread_count_ = DefaultThreadCount;
+
+    /**
+     * Maximum number of concurrent connections, 0 means no limit other than
+     * the one of the underlying server.
+     */
+    uint32_t connection_limit_ = 0;
+
+    /**
+     * Maximum number of concurrent connections from a single address, 0
+     * means no limit.
+     */
+    uint32_t per_ip_connection_limit_ = 0;
+  };
+
   virtual ~IHttpServerFactory() = default;
 
   virtual IHttpServer::Pointer create(IHttpServer::ICallback::Pointer,
@@ -104,6 +150,8 @@ class CLOUDSTORAGE_API IHttpServerFactory {
                                       IHttpServer::Type) = 0;
 
   static IHttpServerFactory::Pointer create();
+
+  static IHttpServerFactory::Pointer create(const Options&);
 };
 
 }  // namespace cloudstorage
@@ -54,6 +54,7 @@ class CLOUDSTORAGE_API IItem {
   static const TimeStamp UnknownTimeStamp;
 
   enum class FileType { Directory, Video, Audio, Image, Unknown };
+  enum class HashType { None, MD5, SHA1, DropboxContentHash, QuickXorHash };
 
   virtual ~IItem() = default;
 
@@ -66,6 +67,13 @@ class CLOUDSTORAGE_API IItem {
   virtual bool is_hidden() const = 0;
   virtual FileType type() const = 0;
 
+  /**
+   * Content hash reported by the provider; hex string, or base64 for
+   * QuickXorHash. Empty if provider didn't report one.
+   */
+  virtual std::string hash() const = 0;
+  virtual HashType hash_type() const = 0;
+
   virtual std::string toString() const = 0;
   static IItem::Pointer fromString(const std::string&);
 };
@@ -52,6 +52,52 @@ struct PageData {
   std::string next_token_;  // empty if no next page
 };
 
+struct ChangeData {
+  IItem::List items_;                 // created or modified items
+  std::vector<std::string> deleted_;  // ids of removed items
+  std::string cursor_;                // pass to the next listChangesAsync call
+};
+
+struct WalkTreeOptions {
+  static constexpr int UnlimitedDepth = -1;
+  static constexpr size_t DefaultConcurrency = 8;
+
+  // 1 reports only the direct children of the root
+  int max_depth_ = UnlimitedDepth;
+  // max count of directory listings running at once
+  size_t concurrency_ = DefaultConcurrency;
+  // returning false skips the item and, for directories, its whole subtree
+  std::function<bool(const std::string& path, const IItem&)> filter_;
+};
+
+struct SegmentedDownloadOptions {
+  static constexpr uint64_t DefaultSegmentSize = 8 * 1024 * 1024;
+  static constexpr size_t DefaultConcurrency = 4;
+  static constexpr uint64_t DefaultBufferSize = 64 * 1024 * 1024;
+
+  // initial size of a segment, later adjusted to measured throughput
+  uint64_t segment_size_ = DefaultSegmentSize;
+  // max count of segments fetched at once; fewer are used as long as adding
+  // one doesn't improve throughput
+  size_t concurrency_ = DefaultConcurrency;
+  // max bytes fetched ahead of data already passed to a callback which
+  // receives it in order
+  uint64_t buffer_size_ = DefaultBufferSize;
+};
+
+struct DownloadToFileOptions {
+  // continue from the length of an existing file instead of overwriting it
+  bool resume_ = false;
+  // write bypassing the page cache where supported, meant for files much
+  // larger than available memory
+  bool direct_io_ = false;
+  // fetch with downloadFileSegmentedAsync, writing segments as they arrive
+  // unless resuming or using direct io; a file left by such download can't
+  // be resumed later, as its length no longer tells how much was written
+  bool segmented_ = false;
+  SegmentedDownloadOptions segmented_options_;
+};
+
 struct Token {
   std::string token_;
   std::string access_token_;
@@ -126,6 +172,21 @@ class IListDirectoryCallback
   virtual void receivedItem(IItem::Pointer item) = 0;
 };
 
+class IWalkTreeCallback : public IGenericCallback<EitherError<void>> {
+ public:
+  using Pointer = std::shared_ptr<IWalkTreeCallback>;
+
+  /**
+   * Called when an item of the tree was found; calls are never made
+   * concurrently.
+   *
+   * @param path path of the item relative to the root, components are
+   * separated by /
+   * @param item found item
+   */
+  virtual void receivedItem(const std::string& path, IItem::Pointer item) = 0;
+};
+
 class IDownloadFileCallback : public IGenericCallback<EitherError<void>> {
  public:
   using Pointer = std::shared_ptr<IDownloadFileCallback>;
@@ -145,6 +206,28 @@ class IDownloadFileCallback : public IGenericCallback<EitherError<void>> {
    * @param now count of bytes downloaded
    */
   virtual void progress(uint64_t total, uint64_t now) = 0;
+
+  /**
+   * Segmented downloads pass data through receivedDataAt as soon as it
+   * arrives, instead of reassembling it for receivedData, if this returns
+   * true; useful e.g. when writing to a file.
+   */
+  virtual bool receivesOutOfOrder() { return false; }
+
+  /**
+   * Called by segmented downloads with part of file at given offset, in no
+   * particular order.
+   *
+   * @param data buffer
+   * @param length length of buffer
+   * @param offset position of the buffer in the file
+   */
+  virtual void receivedDataAt(const char* data, uint32_t length,
+                              uint64_t offset) {
+    (void)data;
+    (void)length;
+    (void)offset;
+  }
 };
 
 class IUploadFileCallback : public IGenericCallback<EitherError<IItem>> {
@@ -157,7 +240,9 @@ class IUploadFileCallback : public IGenericCallback<EitherError<IItem>> {
    * @param data buffer to put data to
    * @param maxlength max count of bytes which can be put to the buffer
    * @param offset byte offset of requested chunk
-   * @return count of bytes put to the buffer
+   * @return count of bytes put to the buffer; a callback which has no data
+   * available yet may pause the upload request and return 0, the data is
+   * requested again once the request is resumed
    */
   virtual uint32_t putData(char* data, uint32_t maxlength, uint64_t offset) = 0;
 
@@ -173,6 +258,23 @@ class IUploadFileCallback : public IGenericCallback<EitherError<IItem>> {
    * @param now count of bytes already uploaded
    */
   virtual void progress(uint64_t total, uint64_t now) = 0;
+
+  /**
+   * Called by providers supporting resumable uploads whenever the server
+   * committed more data; the state can be saved and passed to
+   * ICloudProvider::resumeUploadAsync to continue an interrupted upload.
+   *
+   * @param state serialized upload session
+   */
+  virtual void uploadSession(const std::string& state) { (void)state; }
+
+  /**
+   * Whether putData can be called with any offset, including data which was
+   * already given out; a source which only produces consecutive data once,
+   * like a download in progress, returns false and is then sent in a single
+   * pass, without parts uploaded concurrently or retried.
+   */
+  virtual bool seekable() { return true; }
 };
 
 struct Error {
@@ -265,6 +367,7 @@ using GetItemDataCallback = GenericCallback<EitherError<IItem>>;
 using DeleteItemCallback = GenericCallback<EitherError<void>>;
 using CreateDirectoryCallback = GenericCallback<EitherError<IItem>>;
 using MoveItemCallback = GenericCallback<EitherError<IItem>>;
+using CopyItemCallback = GenericCallback<EitherError<IItem>>;
 using RenameItemCallback = GenericCallback<EitherError<IItem>>;
 using ListDirectoryPageCallback = GenericCallback<EitherError<PageData>>;
 using ListDirectoryCallback = GenericCallback<EitherError<IItem::List>>;
@@ -272,6 +375,7 @@ using DownloadFileCallback = GenericCallback<EitherError<void>>;
 using UploadFileCallback = GenericCallback<EitherError<IItem>>;
 using GetThumbnailCallback = GenericCallback<EitherError<void>>;
 using GeneralDataCallback = GenericCallback<EitherError<GeneralData>>;
+using ListChangesCallback = GenericCallback<EitherError<ChangeData>>;
 
 }  // namespace cloudstorage
 
@@ -0,0 +1,415 @@
+/*****************************************************************************
+ * CopyItemRequest.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "CopyItemRequest.h"
+
+#include <cstring>
+#include <mutex>
+
+#include "CloudProvider/CloudProvider.h"
+#include "Utility/Utility.h"
+
+using namespace std::placeholders;
+
+namespace cloudstorage {
+
+namespace {
+
+const size_t MAX_CONCURRENT_COPIES = 4;
+const size_t BUFFER_SIZE = 8 * 1024 * 1024;
+const size_t INITIAL_BUFFER_SIZE = 64 * 1024;
+const size_t UPLOAD_START_SIZE = 1024 * 1024;
+
+class RingBuffer {
+ public:
+  RingBuffer(size_t size) : data_(size), begin_(), size_() {}
+
+  size_t size() const { return size_; }
+
+  void write(const char* data, size_t length) {
+    if (size_ + length > data_.size()) grow(size_ + length);
+    auto end = (begin_ + size_) % data_.size();
+    auto count = std::min(length, data_.size() - end);
+    memcpy(&data_[end], data, count);
+    memcpy(&data_[0], data + count, length - count);
+    size_ += length;
+  }
+
+  size_t read(char* data, size_t length) {
+    length = std::min(length, size_);
+    auto count = std::min(length, data_.size() - begin_);
+    memcpy(data, &data_[begin_], count);
+    memcpy(data + count, &data_[0], length - count);
+    begin_ = (begin_ + length) % data_.size();
+    size_ -= length;
+    return length;
+  }
+
+ private:
+  void grow(size_t size) {
+    std::vector<char> data(std::max(size, 2 * data_.size()));
+    auto count = read(data.data(), size_);
+    data_.swap(data);
+    begin_ = 0;
+    size_ = count;
+  }
+
+  std::vector<char> data_;
+  size_t begin_;
+  size_t size_;
+};
+
+/**
+ * Passes data from a download to an upload. When the buffer fills up, the
+ * download is paused; when the upload runs out of data, it's paused until
+ * more arrives. Neither side blocks, as both may run on the same http thread.
+ * The upload can't be paused before it's known, so it's started only once
+ * some data is buffered; files of unknown size are buffered whole. Data is
+ * passed on only once, a read at other offset than the next one fails the
+ * upload.
+ */
+class Transfer {
+ public:
+  using Callback = std::function<void(EitherError<IItem>)>;
+
+  Transfer(uint64_t size, IThreadPool* thread_pool, const Callback& callback)
+      : size_(size),
+        thread_pool_(thread_pool),
+        callback_(callback),
+        buffer_(INITIAL_BUFFER_SIZE),
+        consumed_(0),
+        download_paused_(false),
+        upload_waiting_(false),
+        upload_started_(false),
+        downloaded_(false),
+        uploaded_(false),
+        reported_(false) {}
+
+  void set_download(const std::shared_ptr<IGenericRequest>& r) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    download_ = r;
+    if (download_paused_) r->pause();
+  }
+
+  void set_upload(const std::shared_ptr<IGenericRequest>& r) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    upload_ = r;
+    if (upload_waiting_) r->pause();
+  }
+
+  bool begin_upload() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (upload_started_ || error_) return false;
+    if (!downloaded_ && (size_ == IItem::UnknownSize ||
+                         buffer_.size() < std::min<uint64_t>(
+                                              size_, UPLOAD_START_SIZE)))
+      return false;
+    return upload_started_ = true;
+  }
+
+  uint64_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_ != IItem::UnknownSize ? size_ : consumed_ + buffer_.size();
+  }
+
+  void received(const char* data, uint32_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (uploaded_) return;
+    buffer_.write(data, length);
+    if (size_ != IItem::UnknownSize && !download_paused_ &&
+        buffer_.size() >= BUFFER_SIZE) {
+      download_paused_ = true;
+      if (auto r = download_.lock()) r->pause();
+    }
+    wake_upload();
+  }
+
+  uint32_t read(char* data, uint32_t maxlength, uint64_t offset) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (offset != consumed_) {
+      // returning nothing would look like the end of data, so the upload is
+      // cancelled instead
+      if (!error_)
+        error_ = util::make_unique<Error>(
+            Error{IHttpRequest::Failure, util::Error::UPLOAD_DATA_UNAVAILABLE});
+      if (auto r = upload_.lock())
+        thread_pool_->schedule([r] { r->cancel(); });
+      return 0;
+    }
+    auto count = static_cast<uint32_t>(buffer_.read(data, maxlength));
+    consumed_ += count;
+    if (count == 0 && !downloaded_) {
+      upload_waiting_ = true;
+      if (auto r = upload_.lock()) r->pause();
+    }
+    if (download_paused_ && buffer_.size() <= BUFFER_SIZE / 2) {
+      download_paused_ = false;
+      if (auto r = download_.lock()) r->resume();
+    }
+    return count;
+  }
+
+  void downloaded(EitherError<void> e) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    downloaded_ = true;
+    if (e.left() && !error_) error_ = util::make_unique<Error>(*e.left());
+    wake_upload();
+  }
+
+  void uploaded(EitherError<IItem> e) {
+    std::shared_ptr<IGenericRequest> download;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      uploaded_ = true;
+      if (e.left() && !error_) error_ = util::make_unique<Error>(*e.left());
+      item_ = e.right();
+      if (!downloaded_) download = download_.lock();
+    }
+    // cancelling waits for the request to finish, so it can't happen on the
+    // thread which runs it
+    if (download) thread_pool_->schedule([download] { download->cancel(); });
+  }
+
+  void report() {
+    EitherError<IItem> result;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (reported_ || !downloaded_ || (upload_started_ && !uploaded_))
+        return;
+      reported_ = true;
+      if (error_)
+        result = *error_;
+      else
+        result = item_;
+    }
+    callback_(result);
+  }
+
+ private:
+  void wake_upload() {
+    if (!upload_waiting_) return;
+    upload_waiting_ = false;
+    if (auto r = upload_.lock()) r->resume();
+  }
+
+  std::mutex mutex_;
+  uint64_t size_;
+  IThreadPool* thread_pool_;
+  Callback callback_;
+  RingBuffer buffer_;
+  uint64_t consumed_;
+  std::weak_ptr<IGenericRequest> download_;
+  std::weak_ptr<IGenericRequest> upload_;
+  bool download_paused_;
+  bool upload_waiting_;
+  bool upload_started_;
+  bool downloaded_;
+  bool uploaded_;
+  bool reported_;
+  std::unique_ptr<Error> error_;
+  IItem::Pointer item_;
+};
+
+class TransferDownload : public IDownloadFileCallback {
+ public:
+  TransferDownload(std::shared_ptr<Transfer> transfer,
+                   std::function<void()> start_upload)
+      : transfer_(std::move(transfer)),
+        start_upload_(std::move(start_upload)) {}
+
+  void receivedData(const char* data, uint32_t length) override {
+    transfer_->received(data, length);
+    if (transfer_->begin_upload()) start_upload_();
+  }
+
+  void progress(uint64_t, uint64_t) override {}
+
+  void done(EitherError<void> e) override {
+    transfer_->downloaded(e);
+    if (transfer_->begin_upload()) start_upload_();
+    transfer_->report();
+  }
+
+ private:
+  std::shared_ptr<Transfer> transfer_;
+  std::function<void()> start_upload_;
+};
+
+class TransferUpload : public IUploadFileCallback {
+ public:
+  TransferUpload(std::shared_ptr<Transfer> transfer)
+      : transfer_(std::move(transfer)) {}
+
+  uint32_t putData(char* data, uint32_t maxlength, uint64_t offset) override {
+    return transfer_->read(data, maxlength, offset);
+  }
+
+  uint64_t size() override { return transfer_->size(); }
+
+  bool seekable() override { return false; }
+
+  void progress(uint64_t, uint64_t) override {}
+
+  void done(EitherError<IItem> e) override {
+    transfer_->uploaded(e);
+    transfer_->report();
+  }
+
+ private:
+  std::shared_ptr<Transfer> transfer_;
+};
+
+}  // namespace
+
+CopyItemRequest::CopyItemRequest(std::shared_ptr<CloudProvider> p,
+                                 const IItem::Pointer& source,
+                                 std::shared_ptr<ICloudProvider> destination,
+                                 const IItem::Pointer& parent,
+                                 const CopyItemCallback& callback)
+    : Request(std::move(p), callback,
+              std::bind(&CopyItemRequest::resolve, this, _1)),
+      source_(source),
+      destination_(std::move(destination)),
+      parent_(parent),
+      same_account_(false) {}
+
+CopyItemRequest::~CopyItemRequest() { cancel(); }
+
+void CopyItemRequest::resolve(const Request::Pointer& request) {
+  if (parent_->type() != IItem::FileType::Directory)
+    return request->done(
+        Error{IHttpRequest::Forbidden, util::Error::NOT_A_DIRECTORY});
+  same_account_ = destination_->name() == provider()->name() &&
+                  destination_->token() == provider()->token();
+  queue_ = WorkQueue::create(MAX_CONCURRENT_COPIES, [=](EitherError<void> e) {
+    if (e.left())
+      request->done(e.left());
+    else
+      request->done(result_);
+  });
+  add({source_, parent_, true});
+  queue_->start();
+}
+
+bool CopyItemRequest::providerCopySupported(const Task& task) const {
+  std::stringstream stream;
+  return same_account_ &&
+         provider()->copyItemRequest(*task.source_, *task.parent_, stream);
+}
+
+void CopyItemRequest::add(const Task& task) {
+  queue_->add([=](WorkQueue::Completion complete) {
+    copy(task, std::move(complete));
+  });
+}
+
+void CopyItemRequest::copy(const Task& task,
+                           const WorkQueue::Completion& complete) {
+  auto callback =
+      std::bind(&CopyItemRequest::finished, this, task, complete, _1, _2);
+  if (providerCopySupported(task))
+    providerCopy(task, callback);
+  else if (task.source_->type() == IItem::FileType::Directory)
+    copyDirectory(task, callback);
+  else
+    streamCopy(task, callback);
+}
+
+void CopyItemRequest::providerCopy(const Task& task,
+                                   const TaskCallback& callback) {
+  auto p = provider();
+  auto source = task.source_;
+  auto destination = task.parent_;
+  subrequest(
+      std::make_shared<Request<EitherError<IItem>>>(
+          p, [=](EitherError<IItem> e) { callback(e, {}); },
+          [=](Request<EitherError<IItem>>::Pointer r) {
+            r->request(
+                [=](util::Output stream) {
+                  return p->copyItemRequest(*source, *destination, *stream);
+                },
+                [=](EitherError<Response> e) {
+                  if (e.left()) return r->done(e.left());
+                  try {
+                    r->done(p->copyItemResponse(*source, *destination,
+                                                e.right()->output()));
+                  } catch (const std::exception& e) {
+                    r->done(Error{IHttpRequest::Failure, e.what()});
+                  }
+                });
+          })
+          ->run());
+}
+
+void CopyItemRequest::streamCopy(const Task& task,
+                                 const TaskCallback& callback) {
+  auto request = this->shared_from_this();
+  auto source = task.source_;
+  auto parent = task.parent_;
+  auto destination = destination_;
+  auto transfer = std::make_shared<Transfer>(
+      source->size(), provider()->thread_pool(),
+      [=](EitherError<IItem> e) { callback(e, {}); });
+  auto start_upload = [=] {
+    std::shared_ptr<IGenericRequest> upload = destination->uploadFileAsync(
+        parent, source->filename(), std::make_shared<TransferUpload>(transfer));
+    transfer->set_upload(upload);
+    request->subrequest(upload);
+  };
+  std::shared_ptr<IGenericRequest> download = provider()->downloadFileAsync(
+      source, std::make_shared<TransferDownload>(transfer, start_upload),
+      FullRange);
+  transfer->set_download(download);
+  subrequest(download);
+}
+
+void CopyItemRequest::copyDirectory(const Task& task,
+                                    const TaskCallback& callback) {
+  auto request = this->shared_from_this();
+  subrequest(destination_->createDirectoryAsync(
+      task.parent_, task.source_->filename(), [=](EitherError<IItem> e) {
+        if (e.left()) return callback(e, {});
+        auto directory = e.right();
+        request->make_subrequest(
+            &CloudProvider::listDirectorySimpleAsync, task.source_,
+            [=](EitherError<IItem::List> list) {
+              if (list.left()) return callback(list.left(), {});
+              std::vector<Task> children;
+              for (const auto& item : *list.right())
+                children.push_back({item, directory, false});
+              callback(directory, children);
+            });
+      }));
+}
+
+void CopyItemRequest::finished(const Task& task,
+                               const WorkQueue::Completion& complete,
+                               EitherError<IItem> e,
+                               std::vector<Task> children) {
+  if (e.left()) return complete(e.left());
+  if (task.root_) result_ = e.right();
+  for (const auto& t : children) add(t);
+  complete(nullptr);
+}
+
+}  // namespace cloudstorage
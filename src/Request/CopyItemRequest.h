@@ -0,0 +1,69 @@
+/*****************************************************************************
+ * CopyItemRequest.h
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef COPY_ITEM_REQUEST_H
+#define COPY_ITEM_REQUEST_H
+
+#include "ICloudProvider.h"
+#include "Request.h"
+#include "WorkQueue.h"
+
+namespace cloudstorage {
+
+class CopyItemRequest : public Request<EitherError<IItem>> {
+ public:
+  CopyItemRequest(std::shared_ptr<CloudProvider>, const IItem::Pointer& source,
+                  std::shared_ptr<ICloudProvider> destination,
+                  const IItem::Pointer& parent, const CopyItemCallback&);
+  ~CopyItemRequest() override;
+
+ private:
+  struct Task {
+    IItem::Pointer source_;
+    IItem::Pointer parent_;
+    bool root_;
+  };
+  using TaskCallback =
+      std::function<void(EitherError<IItem>, std::vector<Task>)>;
+
+  void resolve(const Request::Pointer&);
+  bool providerCopySupported(const Task&) const;
+  void add(const Task&);
+  void copy(const Task&, const WorkQueue::Completion&);
+  void providerCopy(const Task&, const TaskCallback&);
+  void streamCopy(const Task&, const TaskCallback&);
+  void copyDirectory(const Task&, const TaskCallback&);
+  void finished(const Task&, const WorkQueue::Completion&, EitherError<IItem>,
+                std::vector<Task> children);
+
+  IItem::Pointer source_;
+  std::shared_ptr<ICloudProvider> destination_;
+  IItem::Pointer parent_;
+  bool same_account_;
+  WorkQueue::Pointer queue_;
+  IItem::Pointer result_;
+};
+
+}  // namespace cloudstorage
+
+#endif  // COPY_ITEM_REQUEST_H
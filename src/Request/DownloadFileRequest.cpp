@@ -34,10 +34,12 @@ DownloadFileRequest::DownloadFileRequest(std::shared_ptr<CloudProvider> p,
                                          const IItem::Pointer& file,
                                          const ICallback::Pointer& cb,
                                          Range range,
-                                         const RequestFactory& request_factory)
+                                         const RequestFactory& request_factory,
+                                         bool verify)
     : Request(std::move(p), [=](EitherError<void> e) { cb->done(e); },
               std::bind(&DownloadFileRequest::resolve, this, _1, file, cb.get(),
                         range, request_factory)),
+      verify_(verify),
       stream_wrapper_(std::bind(&ICallback::receivedData, cb.get(), _1, _2)) {}
 
 DownloadFileRequest::~DownloadFileRequest() { cancel(); }
@@ -49,6 +51,7 @@ void DownloadFileRequest::resolve(const Request::Pointer& request,
   send(
       [=](util::Output input) {
         auto request = request_factory(*file, *input);
+        if (verify_) stream_wrapper_.reset(*file, range);
         if (range != FullRange)
           request->setHeaderParameter("Range", util::range_to_string(range));
         return request;
@@ -69,6 +72,9 @@ void DownloadFileRequest::resolve(const Request::Pointer& request,
                   Error{IHttpRequest::ServiceUnavailable,
                         util::Error::INVALID_RANGE_HEADER_RESPONSE});
           }
+          if (!stream_wrapper_.verify(*file))
+            return request->done(Error{IHttpRequest::Failure,
+                                       util::Error::CONTENT_HASH_MISMATCH});
           request->done(nullptr);
         }
       },
@@ -84,10 +90,24 @@ DownloadStreamWrapper::DownloadStreamWrapper(
 
 std::streamsize DownloadStreamWrapper::xsputn(const char_type* data,
                                               std::streamsize length) {
+  if (hash_) hash_->update(data, static_cast<size_t>(length));
   callback_(data, static_cast<uint32_t>(length));
   return length;
 }
 
+void DownloadStreamWrapper::reset(const IItem& file, Range range) {
+  if (range.start_ == 0 && (range.size_ == Range::Full ||
+                            range.size_ == file.size()))
+    hash_ = ContentHash::create(file.hash_type());
+  else
+    hash_ = nullptr;
+}
+
+bool DownloadStreamWrapper::verify(const IItem& file) {
+  auto hash = std::move(hash_);
+  return !hash || ContentHash::matches(file, file.hash_type(), hash->digest());
+}
+
 DownloadFileFromUrlRequest::DownloadFileFromUrlRequest(
     std::shared_ptr<CloudProvider> p, IItem::Pointer file,
     const ICallback::Pointer& cb, Range range)
@@ -106,6 +126,7 @@ void DownloadFileFromUrlRequest::resolve(const Pointer& r,
     r->send(
         [=](util::Output) {
           auto r = provider()->http()->create(url, "GET");
+          stream_wrapper_.reset(*file, range);
           if (range != FullRange)
             r->setHeaderParameter("Range", util::range_to_string(range));
           return r;
@@ -126,6 +147,9 @@ void DownloadFileFromUrlRequest::resolve(const Pointer& r,
                     Error{IHttpRequest::ServiceUnavailable,
                           util::Error::INVALID_RANGE_HEADER_RESPONSE});
             }
+            if (!stream_wrapper_.verify(*file))
+              return r->done(Error{IHttpRequest::Failure,
+                                   util::Error::CONTENT_HASH_MISMATCH});
             r->done(nullptr);
           }
         },
@@ -134,21 +158,26 @@ void DownloadFileFromUrlRequest::resolve(const Pointer& r,
         std::bind(&IDownloadFileCallback::progress, callback, _1, _2), nullptr,
         true);
   };
-  auto cached_url = static_cast<Item*>(file.get())->url();
+  auto cached_url = provider()->cachedUrl(*file);
   auto get_url = [=]() {
     r->make_subrequest(
         &CloudProvider::getItemUrlAsync, file, [=](EitherError<std::string> e) {
           if (e.left()) return r->done(e.left());
           static_cast<Item*>(file.get())->set_url(*e.right());
+          provider()->cacheUrl(*file, *e.right());
           download(*e.right(), [=](EitherError<void> e) { r->done(e); });
         });
   };
   if (!cached_url.empty())
     download(cached_url, [=](EitherError<void> e) {
-      if (e.left())
+      if (e.left() && e.left()->code_ != IHttpRequest::Aborted) {
+        // Links usually die with 403 or 410 before their expected lifetime
+        // ends, get a fresh one.
+        provider()->invalidateUrl(*file);
         get_url();
-      else
+      } else {
         r->done(e);
+      }
     });
   else
     get_url();
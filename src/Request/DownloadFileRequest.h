@@ -26,6 +26,7 @@
 
 #include "IItem.h"
 #include "Request.h"
+#include "Utility/ContentHash.h"
 
 namespace cloudstorage {
 
@@ -35,8 +36,19 @@ class DownloadStreamWrapper : public std::streambuf {
   std::streamsize xsputn(const char_type* data,
                          std::streamsize length) override;
 
+  /**
+   * Starts computing hash of the file's content, if it's downloaded whole.
+   */
+  void reset(const IItem& file, Range);
+
+  /**
+   * Checks computed hash against the one reported for the file.
+   */
+  bool verify(const IItem& file);
+
  private:
   std::function<void(const char*, uint32_t)> callback_;
+  ContentHash::Pointer hash_;
 };
 
 class DownloadFileRequest : public Request<EitherError<void>> {
@@ -45,15 +57,21 @@ class DownloadFileRequest : public Request<EitherError<void>> {
       std::function<IHttpRequest::Pointer(const IItem&, std::ostream&)>;
   using ICallback = IDownloadFileCallback;
 
+  /**
+   * @param verify whether downloaded content should be checked against the
+   * file's hash; not the case for e.g. thumbnails
+   */
   DownloadFileRequest(std::shared_ptr<CloudProvider>,
                       const IItem::Pointer& file, const ICallback::Pointer&,
-                      Range, const RequestFactory& request_factory);
+                      Range, const RequestFactory& request_factory,
+                      bool verify);
   ~DownloadFileRequest() override;
 
  private:
   void resolve(const Request::Pointer& request, const IItem::Pointer& file,
                ICallback*, Range, const RequestFactory& request_factory);
 
+  bool verify_;
   DownloadStreamWrapper stream_wrapper_;
 };
 
@@ -56,6 +56,7 @@ GetItemUrlRequest::GetItemUrlRequest(std::shared_ptr<CloudProvider> p,
                           auto url = provider()->getItemUrlResponse(
                               *item, e.right()->headers(), e.right()->output());
                           static_cast<Item*>(item.get())->set_url(url);
+                          provider()->cacheUrl(*item, url);
                           r->done(url);
                         }
                       } catch (const std::exception& e) {
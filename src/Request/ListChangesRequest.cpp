@@ -0,0 +1,126 @@
+/*****************************************************************************
+ * ListChangesRequest.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "ListChangesRequest.h"
+
+#include <json/json.h>
+
+#include "CloudProvider/CloudProvider.h"
+#include "Utility/Utility.h"
+
+using namespace std::placeholders;
+
+namespace cloudstorage {
+
+namespace {
+
+std::string fingerprint(const IItem& item) {
+  auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+                       item.timestamp().time_since_epoch())
+                       .count();
+  return std::to_string(item.size()) + ":" + std::to_string(timestamp);
+}
+
+}  // namespace
+
+ListChangesRequest::ListChangesRequest(std::shared_ptr<CloudProvider> p,
+                                       const IItem::Pointer& directory,
+                                       const std::string& cursor,
+                                       const ListChangesCallback& callback)
+    : Request(std::move(p), callback,
+              std::bind(&ListChangesRequest::resolve, this, _1, directory,
+                        cursor)) {}
+
+ListChangesRequest::~ListChangesRequest() { cancel(); }
+
+void ListChangesRequest::resolve(const Request::Pointer& request,
+                                 const IItem::Pointer& directory,
+                                 const std::string& cursor) {
+  if (directory->type() != IItem::FileType::Directory)
+    return request->done(
+        Error{IHttpRequest::Bad, util::Error::NOT_A_DIRECTORY});
+  std::stringstream stream;
+  if (provider()->listChangesRequest(*directory, cursor, stream))
+    work(directory, cursor);
+  else
+    compare(directory, cursor);
+}
+
+void ListChangesRequest::work(const IItem::Pointer& directory,
+                              const std::string& cursor) {
+  auto request = this->shared_from_this();
+  request->request(
+      [=](util::Output input) {
+        return request->provider()->listChangesRequest(*directory, cursor,
+                                                       *input);
+      },
+      [=](EitherError<Response> e) {
+        if (e.left()) return request->done(e.left());
+        try {
+          bool has_more = false;
+          auto changes = request->provider()->listChangesResponse(
+              *directory, e.right()->output(), has_more);
+          for (auto&& item : changes.items_) result_.items_.push_back(item);
+          for (auto&& id : changes.deleted_) result_.deleted_.push_back(id);
+          result_.cursor_ = changes.cursor_;
+          if (has_more && !changes.cursor_.empty())
+            work(directory, changes.cursor_);
+          else
+            request->done(result_);
+        } catch (const std::exception& e) {
+          request->done(Error{IHttpRequest::Failure, e.what()});
+        }
+      });
+}
+
+void ListChangesRequest::compare(const IItem::Pointer& directory,
+                                 const std::string& cursor) {
+  Json::Value previous(Json::objectValue);
+  try {
+    if (!cursor.empty()) previous = util::json::from_string(cursor);
+  } catch (const std::exception&) {
+    previous = Json::nullValue;
+  }
+  if (!previous.isObject())
+    return done(Error{IHttpRequest::Bad, util::Error::INVALID_CURSOR});
+  auto request = this->shared_from_this();
+  request->make_subrequest(
+      &CloudProvider::listDirectorySimpleAsync, directory,
+      [=](EitherError<IItem::List> e) {
+        if (e.left()) return request->done(e.left());
+        Json::Value current(Json::objectValue);
+        for (const auto& item : *e.right()) {
+          auto value = fingerprint(*item);
+          if (!cursor.empty() && (!previous.isMember(item->id()) ||
+                                  previous[item->id()].asString() != value))
+            result_.items_.push_back(item);
+          current[item->id()] = value;
+        }
+        for (const auto& id : previous.getMemberNames())
+          if (!current.isMember(id)) result_.deleted_.push_back(id);
+        result_.cursor_ = util::json::to_string(current);
+        request->done(result_);
+      });
+}
+
+}  // namespace cloudstorage
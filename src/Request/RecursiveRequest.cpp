@@ -22,51 +22,66 @@
  *****************************************************************************/
 #include "RecursiveRequest.h"
 
+#include <atomic>
+
 #include "CloudProvider/CloudProvider.h"
 
 namespace cloudstorage {
 
+template <class T>
+constexpr size_t RecursiveRequest<T>::DEFAULT_CONCURRENCY;
+
 template <class T>
 RecursiveRequest<T>::RecursiveRequest(std::shared_ptr<CloudProvider> p,
                                       IItem::Pointer item,
                                       CompleteCallback callback,
-                                      Visitor visitor)
+                                      Visitor visitor, size_t concurrency)
     : Request<T>(p, callback, [=](typename Request<T>::Pointer r) {
-        visit(r, item, [=](const T& e) { r->done(e); }, visitor);
+        auto result = std::make_shared<T>();
+        auto queue = WorkQueue::create(concurrency, [=](EitherError<void> e) {
+          if (e.left())
+            r->done(e.left());
+          else
+            r->done(*result);
+        });
+        visit(r, queue, item, [=](const T& e) { *result = e; }, visitor);
+        queue->start();
       }) {}
 
 template <class T>
 void RecursiveRequest<T>::visit(typename Request<T>::Pointer r,
-                                IItem::Pointer item, CompleteCallback callback,
-                                Visitor visitor) {
-  if (item->type() != IItem::FileType::Directory)
-    visitor(r, item, callback);
-  else
-    r->make_subrequest(&CloudProvider::listDirectorySimpleAsync, item,
-                       [=](EitherError<IItem::List> lst) {
-                         if (lst.left()) return callback(lst.left());
-                         visit(r, lst.right(),
-                               [=](const T& e) {
-                                 if (e.left()) return callback(e);
-                                 visitor(r, item, callback);
-                               },
-                               visitor);
-                       });
-}
-
-template <class T>
-void RecursiveRequest<T>::visit(typename Request<T>::Pointer r,
-                                std::shared_ptr<IItem::List> lst,
+                                WorkQueue::Pointer queue, IItem::Pointer item,
                                 CompleteCallback callback, Visitor visitor) {
-  if (lst->empty()) return callback(T());
-  auto i = lst->back();
-  lst->pop_back();
-  visit(r, i,
-        [=](const T& e) {
-          if (e.left()) return callback(e.left());
-          visit(r, lst, callback, visitor);
-        },
-        visitor);
+  auto run_visitor = [=] {
+    queue->add([=](WorkQueue::Completion complete) {
+      visitor(r, item, [=](const T& e) {
+        if (e.left()) return complete(e.left());
+        callback(e);
+        complete(nullptr);
+      });
+    });
+  };
+  if (item->type() != IItem::FileType::Directory) return run_visitor();
+  queue->add([=](WorkQueue::Completion complete) {
+    r->make_subrequest(
+        &CloudProvider::listDirectorySimpleAsync, item,
+        [=](EitherError<IItem::List> lst) {
+          if (lst.left()) return complete(lst.left());
+          if (lst.right()->empty()) {
+            run_visitor();
+          } else {
+            auto remaining =
+                std::make_shared<std::atomic<size_t>>(lst.right()->size());
+            for (const auto& child : *lst.right())
+              visit(r, queue, child,
+                    [=](const T&) {
+                      if (--*remaining == 0) run_visitor();
+                    },
+                    visitor);
+          }
+          complete(nullptr);
+        });
+  });
 }
 
 template class RecursiveRequest<EitherError<void>>;
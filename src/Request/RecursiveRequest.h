@@ -25,9 +25,17 @@
 #define RECURSIVEREQUEST_H
 
 #include "Request.h"
+#include "WorkQueue.h"
 
 namespace cloudstorage {
 
+/**
+ * Visits all items of the tree in post-order: visitor is called for a
+ * directory once it finished for all of the directory's children. Up to
+ * concurrency listings and visitor calls are in flight at once; after the
+ * first error no new ones are started and the error is reported when the
+ * running ones finish.
+ */
 template <class ReturnValue>
 class RecursiveRequest : public Request<ReturnValue> {
  public:
@@ -35,15 +43,15 @@ class RecursiveRequest : public Request<ReturnValue> {
   using Visitor = std::function<void(typename Request<ReturnValue>::Pointer,
                                      IItem::Pointer, CompleteCallback)>;
 
+  static constexpr size_t DEFAULT_CONCURRENCY = 8;
+
   RecursiveRequest(std::shared_ptr<CloudProvider>, IItem::Pointer item,
-                   CompleteCallback, Visitor);
+                   CompleteCallback, Visitor,
+                   size_t concurrency = DEFAULT_CONCURRENCY);
 
  private:
-  static void visit(typename Request<ReturnValue>::Pointer, IItem::Pointer item,
-                    CompleteCallback, Visitor);
-  static void visit(typename Request<ReturnValue>::Pointer,
-                    std::shared_ptr<IItem::List> lst, CompleteCallback,
-                    Visitor);
+  static void visit(typename Request<ReturnValue>::Pointer, WorkQueue::Pointer,
+                    IItem::Pointer item, CompleteCallback, Visitor);
 };
 
 }  // namespace cloudstorage
@@ -394,5 +394,6 @@ template class Request<EitherError<IItem>>;
 template class Request<EitherError<IItem::List>>;
 template class Request<EitherError<void>>;
 template class Request<EitherError<GeneralData>>;
+template class Request<EitherError<ChangeData>>;
 
 }  // namespace cloudstorage
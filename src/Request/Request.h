@@ -112,6 +112,8 @@ class Request : public IRequest<ReturnValue>,
   bool is_cancelled() const;
   bool is_paused() const;
 
+  void subrequest(std::shared_ptr<IGenericRequest>);
+
   template <class Type = CloudProvider, class Method, class... Args>
   void make_subrequest(Method method, Args... args) {
     if (is_cancelled()) {
@@ -141,8 +143,6 @@ class Request : public IRequest<ReturnValue>,
             const ProgressFunction& download = nullptr,
             const ProgressFunction& upload = nullptr);
 
-  void subrequest(std::shared_ptr<IGenericRequest>);
-
   template <class First, class... Rest>
   struct LastArgument {
     using Type = typename LastArgument<Rest...>::Type;
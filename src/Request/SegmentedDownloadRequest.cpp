@@ -0,0 +1,267 @@
+/*****************************************************************************
+ * SegmentedDownloadRequest.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "SegmentedDownloadRequest.h"
+
+#include <algorithm>
+
+#include "CloudProvider/CloudProvider.h"
+#include "Utility/Utility.h"
+
+namespace cloudstorage {
+
+namespace {
+
+const uint64_t MIN_SEGMENT_SIZE = 256 * 1024;
+const uint64_t MAX_SEGMENT_SIZE = 64 * 1024 * 1024;
+const double SEGMENT_DURATION = 2;
+
+class DownloadCallback : public IDownloadFileCallback {
+ public:
+  DownloadCallback(IDownloadFileCallback* callback,
+                   std::function<void(EitherError<void>)> done)
+      : callback_(callback), done_(std::move(done)) {}
+
+  void receivedData(const char* data, uint32_t length) override {
+    callback_->receivedData(data, length);
+  }
+
+  void progress(uint64_t total, uint64_t now) override {
+    callback_->progress(total, now);
+  }
+
+  void done(EitherError<void> e) override { done_(e); }
+
+ private:
+  IDownloadFileCallback* callback_;
+  std::function<void(EitherError<void>)> done_;
+};
+
+}  // namespace
+
+class SegmentedDownloadRequest::SegmentCallback : public IDownloadFileCallback {
+ public:
+  SegmentCallback(std::shared_ptr<SegmentedDownloadRequest> request,
+                  std::shared_ptr<Segment> segment)
+      : request_(std::move(request)), segment_(std::move(segment)) {}
+
+  void receivedData(const char* data, uint32_t length) override {
+    request_->received(*segment_, data, length);
+  }
+
+  void progress(uint64_t, uint64_t) override {}
+
+  void done(EitherError<void> e) override { request_->finished(segment_, e); }
+
+ private:
+  std::shared_ptr<SegmentedDownloadRequest> request_;
+  std::shared_ptr<Segment> segment_;
+};
+
+SegmentedDownloadRequest::SegmentedDownloadRequest(
+    std::shared_ptr<CloudProvider> p, const IItem::Pointer& file,
+    const ICallback::Pointer& cb, const SegmentedDownloadOptions& options)
+    : Request(std::move(p), [=](EitherError<void> e) { cb->done(e); },
+              std::bind(&SegmentedDownloadRequest::resolve, this,
+                        std::placeholders::_1)),
+      file_(file),
+      callback_(cb.get()),
+      options_(options),
+      out_of_order_(cb->receivesOutOfOrder()),
+      next_offset_(0),
+      delivered_(0),
+      received_(0),
+      segment_size_(std::max(options.segment_size_, MIN_SEGMENT_SIZE)),
+      window_(0),
+      running_(0),
+      finished_(false),
+      round_bytes_(0),
+      round_segments_(0),
+      throughput_(0) {
+  options_.concurrency_ = std::max<size_t>(options_.concurrency_, 1);
+  options_.buffer_size_ = std::max(options_.buffer_size_, MIN_SEGMENT_SIZE);
+  window_ = std::min<size_t>(options_.concurrency_, 2);
+  segment_size_ = std::min(segment_size_, max_segment_size());
+}
+
+SegmentedDownloadRequest::~SegmentedDownloadRequest() { cancel(); }
+
+void SegmentedDownloadRequest::resolve(const Request::Pointer& request) {
+  if (file_->size() == IItem::UnknownSize || file_->size() <= segment_size_)
+    return request->subrequest(provider()->downloadFileAsync(
+        file_,
+        std::make_shared<DownloadCallback>(
+            callback_, [=](EitherError<void> e) { request->done(e); }),
+        FullRange));
+  round_start_ = std::chrono::steady_clock::now();
+  schedule();
+}
+
+void SegmentedDownloadRequest::schedule() {
+  std::vector<std::shared_ptr<Segment>> segments;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (finished_) return;
+    while (!error_ && running_ < window_ && next_offset_ < file_->size()) {
+      auto size = std::min(segment_size_, file_->size() - next_offset_);
+      // when reassembling, don't let segments stuck behind a slow one pile up
+      if (!out_of_order_ && !pending_.empty() &&
+          next_offset_ + size - delivered_ > options_.buffer_size_)
+        break;
+      auto segment = std::make_shared<Segment>(
+          Segment{next_offset_, size, 0, false, "",
+                  std::chrono::steady_clock::now(), false});
+      pending_[next_offset_] = segment;
+      next_offset_ += size;
+      running_++;
+      segments.push_back(segment);
+    }
+  }
+  for (const auto& s : segments) fetch(s);
+}
+
+void SegmentedDownloadRequest::fetch(const std::shared_ptr<Segment>& s) {
+  auto request =
+      std::static_pointer_cast<SegmentedDownloadRequest>(shared_from_this());
+  subrequest(provider()->downloadFileAsync(
+      file_, std::make_shared<SegmentCallback>(request, s),
+      Range{s->offset_ + s->received_, s->size_ - s->received_}));
+}
+
+void SegmentedDownloadRequest::received(Segment& segment, const char* data,
+                                        uint32_t length) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error_ || finished_) return;
+  length = static_cast<uint32_t>(
+      std::min<uint64_t>(length, segment.size_ - segment.received_));
+  auto offset = segment.offset_ + segment.received_;
+  if (out_of_order_) {
+    callback_->receivedDataAt(data, length, offset);
+  } else if (offset == delivered_) {
+    callback_->receivedData(data, length);
+    delivered_ += length;
+  } else {
+    segment.data_.append(data, length);
+  }
+  segment.received_ += length;
+  received_ += length;
+  callback_->progress(file_->size(), received_);
+}
+
+void SegmentedDownloadRequest::finished(const std::shared_ptr<Segment>& segment,
+                                        EitherError<void> e) {
+  bool finished = false;
+  bool retry = false;
+  std::unique_ptr<Error> error;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_--;
+    if (!error_) {
+      if (e.left() || segment->received_ != segment->size_) {
+        auto aborted = e.left() && e.left()->code_ == IHttpRequest::Aborted;
+        if (!segment->retried_ && !aborted && !finished_) {
+          segment->retried_ = retry = true;
+          running_++;
+        } else if (e.left()) {
+          error_ = util::make_unique<Error>(*e.left());
+        } else {
+          error_ = util::make_unique<Error>(
+              Error{IHttpRequest::Failure, util::Error::INCOMPLETE_SEGMENT});
+        }
+      } else {
+        segment->finished_ = true;
+        if (out_of_order_)
+          pending_.erase(segment->offset_);
+        else
+          flush();
+        adapt(*segment);
+      }
+    }
+    if (!finished_ && running_ == 0 &&
+        (error_ || next_offset_ >= file_->size())) {
+      finished = finished_ = true;
+      error = std::move(error_);
+    }
+  }
+  if (finished) {
+    if (error)
+      done(*error);
+    else
+      done(nullptr);
+  } else if (retry) {
+    fetch(segment);
+  } else {
+    schedule();
+  }
+}
+
+void SegmentedDownloadRequest::flush() {
+  while (!pending_.empty()) {
+    auto& segment = *pending_.begin()->second;
+    if (!segment.data_.empty()) {
+      callback_->receivedData(segment.data_.data(),
+                              static_cast<uint32_t>(segment.data_.size()));
+      delivered_ += segment.data_.size();
+      std::string().swap(segment.data_);
+    }
+    if (!segment.finished_) break;
+    pending_.erase(pending_.begin());
+  }
+}
+
+uint64_t SegmentedDownloadRequest::max_segment_size() const {
+  if (out_of_order_) return MAX_SEGMENT_SIZE;
+  // leave room in the buffer for a full window of segments
+  return std::max(std::min(MAX_SEGMENT_SIZE,
+                           options_.buffer_size_ / options_.concurrency_),
+                  MIN_SEGMENT_SIZE);
+}
+
+void SegmentedDownloadRequest::adapt(const Segment& segment) {
+  auto now = std::chrono::steady_clock::now();
+  auto elapsed =
+      std::chrono::duration<double>(now - segment.start_).count();
+  if (elapsed > 0) {
+    auto target =
+        static_cast<uint64_t>(segment.size_ / elapsed * SEGMENT_DURATION);
+    segment_size_ =
+        std::min(std::max((segment_size_ + target) / 2, MIN_SEGMENT_SIZE),
+                 max_segment_size());
+  }
+  round_bytes_ += segment.size_;
+  if (++round_segments_ < window_) return;
+  auto round = std::chrono::duration<double>(now - round_start_).count();
+  if (round > 0) {
+    auto throughput = round_bytes_ / round;
+    if (throughput > throughput_ * 1.1)
+      window_ = std::min(window_ + 1, options_.concurrency_);
+    else if (throughput < throughput_ * 0.7)
+      window_ = std::max<size_t>(window_ - 1, 1);
+    throughput_ = throughput;
+  }
+  round_start_ = now;
+  round_bytes_ = 0;
+  round_segments_ = 0;
+}
+
+}  // namespace cloudstorage
@@ -0,0 +1,88 @@
+/*****************************************************************************
+ * SegmentedDownloadRequest.h
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef SEGMENTED_DOWNLOAD_REQUEST_H
+#define SEGMENTED_DOWNLOAD_REQUEST_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+
+#include "Request.h"
+
+namespace cloudstorage {
+
+class SegmentedDownloadRequest : public Request<EitherError<void>> {
+ public:
+  using ICallback = IDownloadFileCallback;
+
+  SegmentedDownloadRequest(std::shared_ptr<CloudProvider>,
+                           const IItem::Pointer& file,
+                           const ICallback::Pointer&,
+                           const SegmentedDownloadOptions&);
+  ~SegmentedDownloadRequest() override;
+
+ private:
+  struct Segment {
+    uint64_t offset_;
+    uint64_t size_;
+    uint64_t received_;
+    bool finished_;
+    std::string data_;
+    std::chrono::steady_clock::time_point start_;
+    bool retried_;
+  };
+  class SegmentCallback;
+
+  void resolve(const Request::Pointer&);
+  void schedule();
+  void fetch(const std::shared_ptr<Segment>&);
+  void received(Segment&, const char* data, uint32_t length);
+  void finished(const std::shared_ptr<Segment>&, EitherError<void>);
+  void flush();
+  void adapt(const Segment&);
+  uint64_t max_segment_size() const;
+
+  IItem::Pointer file_;
+  ICallback* callback_;
+  SegmentedDownloadOptions options_;
+  bool out_of_order_;
+  std::mutex mutex_;
+  uint64_t next_offset_;
+  uint64_t delivered_;
+  uint64_t received_;
+  uint64_t segment_size_;
+  size_t window_;
+  size_t running_;
+  bool finished_;
+  std::unique_ptr<Error> error_;
+  std::map<uint64_t, std::shared_ptr<Segment>> pending_;
+  std::chrono::steady_clock::time_point round_start_;
+  uint64_t round_bytes_;
+  size_t round_segments_;
+  double throughput_;
+};
+
+}  // namespace cloudstorage
+
+#endif  // SEGMENTED_DOWNLOAD_REQUEST_H
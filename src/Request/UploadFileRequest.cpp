@@ -23,6 +23,10 @@
 
 #include "UploadFileRequest.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
 #include "CloudProvider/CloudProvider.h"
 
 using namespace std::placeholders;
@@ -46,6 +50,7 @@ void UploadFileRequest::resolve(
     const UploadStreamWrapper::Pointer& stream_wrapper,
     const IItem::Pointer& directory, const std::string& filename,
     const ICallback::Pointer& callback) {
+  stream_wrapper->hash_type_ = r->provider()->hashType();
   r->send(
       [=](util::Output) {
         stream_wrapper->reset();
@@ -56,9 +61,12 @@ void UploadFileRequest::resolve(
       [=](EitherError<Response> e) {
         if (e.left()) return r->done(e.left());
         try {
-          r->done(r->provider()->uploadFileResponse(*directory, filename,
-                                                    stream_wrapper->size_,
-                                                    e.right()->output()));
+          auto item = r->provider()->uploadFileResponse(
+              *directory, filename, stream_wrapper->size_, e.right()->output());
+          if (!stream_wrapper->verify(*item))
+            return r->done(Error{IHttpRequest::Failure,
+                                 util::Error::CONTENT_HASH_MISMATCH});
+          r->done(item);
         } catch (const std::exception&) {
           r->done(Error{IHttpRequest::Failure, e.right()->output().str()});
         }
@@ -75,12 +83,19 @@ UploadStreamWrapper::UploadStreamWrapper(
       callback_(std::move(callback)),
       size_(size),
       read_(),
-      position_() {}
+      position_(),
+      hash_type_(IItem::HashType::None) {}
 
 void UploadStreamWrapper::reset() {
   prefix_ = std::stringstream();
   suffix_ = std::stringstream();
   read_ = 0;
+  hash_ = ContentHash::create(hash_type_);
+}
+
+bool UploadStreamWrapper::verify(const IItem& item) const {
+  return !hash_ || read_ != size_ ||
+         ContentHash::matches(item, hash_type_, hash_->digest());
 }
 
 UploadStreamWrapper::pos_type UploadStreamWrapper::seekoff(
@@ -95,25 +110,45 @@ UploadStreamWrapper::pos_type UploadStreamWrapper::seekoff(
 }
 
 std::streambuf::int_type UploadStreamWrapper::underflow() {
-  pos_type read_data = 0;
+  auto count = read(buffer_, BUFFER_SIZE);
+  setg(buffer_, buffer_, buffer_ + count);
+  return count == 0 ? std::char_traits<char>::eof()
+                    : std::char_traits<char>::to_int_type(*gptr());
+}
+
+std::streamsize UploadStreamWrapper::xsgetn(char_type* data,
+                                            std::streamsize length) {
+  std::streamsize count = std::min<std::streamsize>(egptr() - gptr(), length);
+  if (count > 0) {
+    memcpy(data, gptr(), static_cast<size_t>(count));
+    gbump(static_cast<int>(count));
+  }
+  return count + read(data + count, length - count);
+}
+
+std::streamsize UploadStreamWrapper::read(char* data, std::streamsize length) {
+  std::streamsize count = 0;
   if (prefix_) {
-    prefix_.read(buffer_ + read_data, BUFFER_SIZE - read_data);
-    read_data += prefix_.gcount();
+    prefix_.read(data, length);
+    count += prefix_.gcount();
   }
-  if (read_ < size_ && !prefix_) {
-    uint32_t size =
-        callback_(buffer_ + read_data,
-                  static_cast<uint32_t>(BUFFER_SIZE - read_data), read_);
-    read_data += size;
+  while (read_ < size_ && count < length && !prefix_) {
+    auto size = callback_(
+        data + count,
+        static_cast<uint32_t>(std::min<uint64_t>(
+            {static_cast<uint64_t>(length - count), size_ - read_,
+             UINT32_MAX})),
+        read_);
+    if (size == 0) break;
+    if (hash_) hash_->update(data + count, size);
+    count += size;
     read_ += size;
   }
-  if (read_ == size_ && !prefix_) {
-    suffix_.read(buffer_ + read_data, BUFFER_SIZE - read_data);
-    read_data += suffix_.gcount();
+  if (read_ == size_ && !prefix_ && count < length) {
+    suffix_.read(data + count, length - count);
+    count += suffix_.gcount();
   }
-  if (gptr() == egptr()) setg(buffer_, buffer_, buffer_ + read_data);
-  return gptr() == egptr() ? std::char_traits<char>::eof()
-                           : std::char_traits<char>::to_int_type(*gptr());
+  return count;
 }
 
 }  // namespace cloudstorage
@@ -26,9 +26,15 @@
 
 #include "IItem.h"
 #include "Request.h"
+#include "Utility/ContentHash.h"
 
 namespace cloudstorage {
 
+/**
+ * Serves upload body made of prefix_, file's data and suffix_. Bulk reads
+ * (e.g. from http library's read callback) are served straight into caller's
+ * buffer, without going through the internal one.
+ */
 class UploadStreamWrapper : public std::streambuf {
  public:
   using Pointer = std::shared_ptr<UploadStreamWrapper>;
@@ -40,9 +46,23 @@ class UploadStreamWrapper : public std::streambuf {
       uint64_t size);
   void reset();
 
+  /**
+   * Checks hash reported for uploaded item against the one computed while
+   * reading the data; hash_type_ has to be set before the upload starts.
+   */
+  bool verify(const IItem&) const;
+
   pos_type seekoff(off_type, std::ios_base::seekdir,
                    std::ios_base::openmode) override;
   int_type underflow() override;
+  std::streamsize xsgetn(char_type*, std::streamsize) override;
+
+  /**
+   * Copies next part of upload body to the buffer.
+   *
+   * @return count of bytes copied, less than length only at the end
+   */
+  std::streamsize read(char* data, std::streamsize length);
 
   char buffer_[BUFFER_SIZE];
   std::function<uint32_t(char*, uint32_t, uint64_t)> callback_;
@@ -51,6 +71,8 @@ class UploadStreamWrapper : public std::streambuf {
   uint64_t size_;
   uint64_t read_;
   pos_type position_;
+  IItem::HashType hash_type_;
+  ContentHash::Pointer hash_;
 };
 
 class UploadFileRequest : public Request<EitherError<IItem>> {
@@ -0,0 +1,161 @@
+/*****************************************************************************
+ * WalkTreeRequest.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "WalkTreeRequest.h"
+
+#include <algorithm>
+
+#include "CloudProvider/CloudProvider.h"
+#include "Utility/Utility.h"
+
+using namespace std::placeholders;
+
+namespace cloudstorage {
+
+namespace {
+
+std::string join(const std::string& path, const std::string& filename) {
+  return path.empty() ? filename : path + "/" + filename;
+}
+
+int depth(const std::string& path) {
+  return static_cast<int>(std::count(path.begin(), path.end(), '/')) + 1;
+}
+
+}  // namespace
+
+WalkTreeRequest::WalkTreeRequest(std::shared_ptr<CloudProvider> p,
+                                 const IItem::Pointer& root,
+                                 const ICallback::Pointer& cb,
+                                 const WalkTreeOptions& options)
+    : Request(std::move(p), [=](EitherError<void> e) { cb->done(e); },
+              std::bind(&WalkTreeRequest::resolve, this, _1, root)),
+      options_(options),
+      callback_(cb.get()) {}
+
+WalkTreeRequest::~WalkTreeRequest() { cancel(); }
+
+void WalkTreeRequest::resolve(const Request::Pointer& request,
+                              const IItem::Pointer& root) {
+  if (root->type() != IItem::FileType::Directory)
+    return request->done(
+        Error{IHttpRequest::Forbidden, util::Error::NOT_A_DIRECTORY});
+  if (options_.max_depth_ == 0) return request->done(nullptr);
+  std::stringstream stream;
+  if (options_.max_depth_ != 1 &&
+      provider()->walkTreeRequest(*root, "", stream))
+    return recursiveListing(root, "");
+  queue_ = WorkQueue::create(options_.concurrency_, [=](EitherError<void> e) {
+    request->done(e);
+  });
+  add({"", 0, root, ""});
+  queue_->start();
+}
+
+void WalkTreeRequest::recursiveListing(const IItem::Pointer& root,
+                                       const std::string& page_token) {
+  auto request = this->shared_from_this();
+  request->request(
+      [=](util::Output input) {
+        return request->provider()->walkTreeRequest(*root, page_token, *input);
+      },
+      [=](EitherError<Response> e) {
+        if (e.left()) return request->done(e.left());
+        try {
+          std::string next_page_token;
+          auto entries = request->provider()->walkTreeResponse(
+              *root, e.right()->output(), next_page_token);
+          std::sort(entries.begin(), entries.end(),
+                    [](const CloudProvider::TreeEntries::value_type& a,
+                       const CloudProvider::TreeEntries::value_type& b) {
+                      return a.first < b.first;
+                    });
+          for (const auto& d : entries) {
+            const auto& path = d.first;
+            bool is_directory = d.second->type() == IItem::FileType::Directory;
+            if (path.empty() ||
+                (is_directory && directories_.count(path) != 0))
+              continue;
+            bool pruned = false;
+            for (auto it = path.find('/'); !pruned && it != std::string::npos;
+                 it = path.find('/', it + 1))
+              pruned = pruned_.count(path.substr(0, it)) != 0;
+            if (pruned) continue;
+            if (!accept(path, *d.second, depth(path))) {
+              if (is_directory) pruned_.insert(path);
+              continue;
+            }
+            if (is_directory) directories_.insert(path);
+            report(path, d.second);
+          }
+          if (!next_page_token.empty())
+            recursiveListing(root, next_page_token);
+          else
+            request->done(nullptr);
+        } catch (const std::exception& e) {
+          request->done(Error{IHttpRequest::Failure, e.what()});
+        }
+      });
+}
+
+void WalkTreeRequest::add(const Task& task) {
+  queue_->add(
+      [=](WorkQueue::Completion complete) { list(task, std::move(complete)); });
+}
+
+void WalkTreeRequest::list(const Task& task,
+                           const WorkQueue::Completion& complete) {
+  auto request = this->shared_from_this();
+  request->make_subrequest(
+      &CloudProvider::listDirectoryPageAsync, task.directory_,
+      task.page_token_, [=](EitherError<PageData> e) {
+        if (e.left()) return complete(e.left());
+        for (const auto& d : e.right()->items_) {
+          auto path = join(task.path_, d->filename());
+          auto depth = task.depth_ + 1;
+          if (!accept(path, *d, depth)) continue;
+          report(path, d);
+          if (d->type() == IItem::FileType::Directory &&
+              (options_.max_depth_ < 0 || depth < options_.max_depth_))
+            add({path, depth, d, ""});
+        }
+        if (!e.right()->next_token_.empty())
+          add({task.path_, task.depth_, task.directory_,
+               e.right()->next_token_});
+        complete(nullptr);
+      });
+}
+
+bool WalkTreeRequest::accept(const std::string& path, const IItem& item,
+                             int depth) const {
+  if (options_.max_depth_ >= 0 && depth > options_.max_depth_) return false;
+  return !options_.filter_ || options_.filter_(path, item);
+}
+
+void WalkTreeRequest::report(const std::string& path,
+                             const IItem::Pointer& item) {
+  std::lock_guard<std::mutex> lock(callback_mutex_);
+  callback_->receivedItem(path, item);
+}
+
+}  // namespace cloudstorage
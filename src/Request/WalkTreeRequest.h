@@ -0,0 +1,69 @@
+/*****************************************************************************
+ * WalkTreeRequest.h
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef WALK_TREE_REQUEST_H
+#define WALK_TREE_REQUEST_H
+
+#include <mutex>
+#include <unordered_set>
+
+#include "Request.h"
+#include "WorkQueue.h"
+
+namespace cloudstorage {
+
+class WalkTreeRequest : public Request<EitherError<void>> {
+ public:
+  using ICallback = IWalkTreeCallback;
+
+  WalkTreeRequest(std::shared_ptr<CloudProvider>, const IItem::Pointer& root,
+                  const ICallback::Pointer&, const WalkTreeOptions&);
+  ~WalkTreeRequest() override;
+
+ private:
+  struct Task {
+    std::string path_;
+    int depth_;
+    IItem::Pointer directory_;
+    std::string page_token_;
+  };
+
+  void resolve(const Request::Pointer&, const IItem::Pointer& root);
+  void recursiveListing(const IItem::Pointer& root,
+                        const std::string& page_token);
+  void add(const Task&);
+  void list(const Task&, const WorkQueue::Completion&);
+  bool accept(const std::string& path, const IItem&, int depth) const;
+  void report(const std::string& path, const IItem::Pointer&);
+
+  WalkTreeOptions options_;
+  ICallback* callback_;
+  WorkQueue::Pointer queue_;
+  std::mutex callback_mutex_;
+  std::unordered_set<std::string> directories_;
+  std::unordered_set<std::string> pruned_;
+};
+
+}  // namespace cloudstorage
+
+#endif  // WALK_TREE_REQUEST_H
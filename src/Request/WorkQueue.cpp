@@ -0,0 +1,111 @@
+/*****************************************************************************
+ * WorkQueue.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "WorkQueue.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "Utility/Utility.h"
+
+namespace cloudstorage {
+
+WorkQueue::Pointer WorkQueue::create(size_t concurrency, Completion complete) {
+  return std::make_shared<WorkQueue>(concurrency, std::move(complete));
+}
+
+void WorkQueue::for_each(size_t count, size_t concurrency,
+                         std::function<void(size_t, Completion)> task,
+                         Completion complete) {
+  auto queue = create(concurrency, std::move(complete));
+  for (size_t i = 0; i < count; i++)
+    queue->add([=](Completion complete) { task(i, complete); });
+  queue->start();
+}
+
+WorkQueue::WorkQueue(size_t concurrency, Completion complete)
+    : concurrency_(std::max<size_t>(concurrency, 1)),
+      running_(0),
+      started_(false),
+      finished_(false),
+      completion_(std::move(complete)) {}
+
+void WorkQueue::add(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_ || finished_) return;
+    queue_.push_back(std::move(task));
+  }
+  schedule();
+}
+
+void WorkQueue::start() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    started_ = true;
+  }
+  schedule();
+}
+
+void WorkQueue::schedule() {
+  std::vector<Task> tasks;
+  Completion completion;
+  std::unique_ptr<Error> error;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_ || finished_) return;
+    while (!error_ && running_ < concurrency_ && !queue_.empty()) {
+      tasks.push_back(std::move(queue_.front()));
+      queue_.pop_front();
+      running_++;
+    }
+    if (running_ == 0) {
+      finished_ = true;
+      completion = util::exchange(completion_, nullptr);
+      error = std::move(error_);
+    }
+  }
+  if (completion) {
+    if (error)
+      completion(*error);
+    else
+      completion(nullptr);
+  }
+  auto self = shared_from_this();
+  for (const auto& task : tasks)
+    task([self](EitherError<void> e) { self->finished(e); });
+}
+
+void WorkQueue::finished(EitherError<void> e) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_--;
+    if (e.left()) {
+      if (!error_) error_ = util::make_unique<Error>(*e.left());
+      queue_.clear();
+    }
+  }
+  schedule();
+}
+
+}  // namespace cloudstorage
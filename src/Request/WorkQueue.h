@@ -0,0 +1,84 @@
+/*****************************************************************************
+ * WorkQueue.h
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "IRequest.h"
+
+namespace cloudstorage {
+
+/**
+ * Runs tasks with at most concurrency of them in flight; running tasks may
+ * add more. After the first task fails no new ones are started, and once
+ * nothing is left running the completion is called with that task's error.
+ */
+class WorkQueue : public std::enable_shared_from_this<WorkQueue> {
+ public:
+  using Pointer = std::shared_ptr<WorkQueue>;
+  using Completion = std::function<void(EitherError<void>)>;
+  using Task = std::function<void(Completion)>;
+
+  static Pointer create(size_t concurrency, Completion);
+
+  /**
+   * Runs task for indices in [0, count).
+   */
+  static void for_each(size_t count, size_t concurrency,
+                       std::function<void(size_t index, Completion)> task,
+                       Completion);
+
+  WorkQueue(size_t concurrency, Completion);
+
+  /**
+   * Queues the task; tasks added after a failure are dropped.
+   */
+  void add(Task);
+
+  /**
+   * Starts running the queued tasks; if there are none, completes right away.
+   */
+  void start();
+
+ private:
+  void schedule();
+  void finished(EitherError<void>);
+
+  std::mutex mutex_;
+  size_t concurrency_;
+  size_t running_;
+  bool started_;
+  bool finished_;
+  std::deque<Task> queue_;
+  std::unique_ptr<Error> error_;
+  Completion completion_;
+};
+
+}  // namespace cloudstorage
+
+#endif  // WORK_QUEUE_H
@@ -0,0 +1,162 @@
+/*****************************************************************************
+ * ChunkReader.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#include "ChunkReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Request/UploadFileRequest.h"
+
+namespace cloudstorage {
+
+namespace {
+
+const size_t MAX_FREE_BUFFERS = 2;
+
+}  // namespace
+
+struct ChunkReader::Chunk {
+  uint64_t offset_;
+  uint32_t length_;
+  uint32_t filled_;
+  std::vector<char> buffer_;
+};
+
+class ChunkReader::Buffers {
+ public:
+  std::vector<char> get(uint32_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) return std::vector<char>(size);
+    auto buffer = std::move(free_.back());
+    free_.pop_back();
+    buffer.resize(size);
+    return buffer;
+  }
+
+  void put(std::vector<char>&& buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.size() < MAX_FREE_BUFFERS) free_.push_back(std::move(buffer));
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::vector<char>> free_;
+};
+
+class ChunkReader::ChunkStream : public std::iostream {
+ public:
+  ChunkStream(std::shared_ptr<ChunkReader> reader, std::shared_ptr<Chunk> chunk)
+      : std::iostream(&buffer_),
+        reader_(std::move(reader)),
+        chunk_(std::move(chunk)),
+        buffer_(std::bind(&ChunkReader::copy, reader_.get(), std::ref(*chunk_),
+                          std::placeholders::_1, std::placeholders::_2,
+                          std::placeholders::_3),
+                chunk_->length_) {}
+
+ private:
+  std::shared_ptr<ChunkReader> reader_;
+  std::shared_ptr<Chunk> chunk_;
+  UploadStreamWrapper buffer_;
+};
+
+ChunkReader::ChunkReader(IUploadFileCallback::Pointer callback,
+                         uint32_t chunk_size, IItem::HashType hash_type)
+    : callback_(std::move(callback)),
+      size_(callback_->size()),
+      chunk_size_(chunk_size),
+      buffers_(std::make_shared<Buffers>()),
+      hash_type_(hash_type),
+      hash_(ContentHash::create(hash_type)),
+      hashed_() {}
+
+ChunkReader::~ChunkReader() {
+  if (next_.valid()) next_.wait();
+}
+
+std::shared_ptr<std::iostream> ChunkReader::read(uint64_t offset,
+                                                 uint32_t& length) {
+  if (!current_ || current_->offset_ != offset) {
+    current_ = nullptr;
+    if (next_.valid()) {
+      auto next = next_.get();
+      if (next->offset_ == offset) current_ = std::move(next);
+    }
+    if (!current_) current_ = fill(offset);
+    auto following = offset + current_->length_;
+    if (current_->length_ > 0 && following < size_)
+      next_ = std::async(std::launch::async,
+                         [this, following] { return fill(following); });
+  }
+  length = current_->length_;
+  return std::make_shared<ChunkStream>(shared_from_this(), current_);
+}
+
+bool ChunkReader::verify(const IItem& item) {
+  if (next_.valid()) next_.wait();
+  if (!hash_ || hashed_ != size_) return true;
+  auto hash = std::move(hash_);
+  return ContentHash::matches(item, hash_type_, hash->digest());
+}
+
+std::shared_ptr<ChunkReader::Chunk> ChunkReader::fill(uint64_t offset) {
+  auto length = static_cast<uint32_t>(
+      std::min<uint64_t>(chunk_size_, offset < size_ ? size_ - offset : 0));
+  auto buffers = buffers_;
+  std::shared_ptr<Chunk> chunk(
+      new Chunk{offset, length, 0, buffers->get(length)},
+      [buffers](Chunk* chunk) {
+        buffers->put(std::move(chunk->buffer_));
+        delete chunk;
+      });
+  pull(*chunk);
+  return chunk;
+}
+
+void ChunkReader::pull(Chunk& chunk) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (chunk.filled_ < chunk.length_) {
+    auto count = callback_->putData(chunk.buffer_.data() + chunk.filled_,
+                                    chunk.length_ - chunk.filled_,
+                                    chunk.offset_ + chunk.filled_);
+    if (count == 0) break;
+    if (hash_ && chunk.offset_ + chunk.filled_ == hashed_) {
+      hash_->update(chunk.buffer_.data() + chunk.filled_, count);
+      hashed_ += count;
+    }
+    chunk.filled_ += count;
+  }
+}
+
+uint32_t ChunkReader::copy(Chunk& chunk, char* data, uint32_t length,
+                           uint64_t offset) {
+  if (offset + length > chunk.filled_) pull(chunk);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (offset >= chunk.filled_) return 0;
+  auto count =
+      static_cast<uint32_t>(std::min<uint64_t>(length, chunk.filled_ - offset));
+  memcpy(data, chunk.buffer_.data() + offset, count);
+  return count;
+}
+
+}  // namespace cloudstorage
@@ -0,0 +1,94 @@
+/*****************************************************************************
+ * ChunkReader.h
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef CHUNKREADER_H
+#define CHUNKREADER_H
+
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "IRequest.h"
+#include "Utility/ContentHash.h"
+
+namespace cloudstorage {
+
+/**
+ * Reads consecutive chunks of an uploaded file for providers which send it
+ * with a request per chunk. Once a chunk is read, the following one is read
+ * in the background, so that reading the source overlaps with sending; chunk
+ * buffers are reused. Content hash of the file is computed on the way, if the
+ * file is read from the beginning. A source which doesn't have the whole chunk
+ * available yet may return less; the rest is read while the chunk is sent.
+ */
+class ChunkReader : public std::enable_shared_from_this<ChunkReader> {
+ public:
+  using Pointer = std::shared_ptr<ChunkReader>;
+
+  ChunkReader(IUploadFileCallback::Pointer callback, uint32_t chunk_size,
+              IItem::HashType = IItem::HashType::None);
+  ~ChunkReader();
+
+  /**
+   * Returns stream with chunk starting at the offset; may be called again
+   * with the same offset when the request is retried.
+   *
+   * @param offset
+   * @param length set to the length of the chunk
+   * @return stream with chunk's data
+   */
+  std::shared_ptr<std::iostream> read(uint64_t offset, uint32_t& length);
+
+  uint64_t size() const { return size_; }
+
+  /**
+   * Checks hash reported for uploaded item against the one computed from
+   * data read; succeeds if the hash couldn't be computed.
+   */
+  bool verify(const IItem&);
+
+ private:
+  struct Chunk;
+  class Buffers;
+
+  class ChunkStream;
+
+  std::shared_ptr<Chunk> fill(uint64_t offset);
+  void pull(Chunk&);
+  uint32_t copy(Chunk&, char* data, uint32_t length, uint64_t offset);
+
+  IUploadFileCallback::Pointer callback_;
+  uint64_t size_;
+  uint32_t chunk_size_;
+  std::shared_ptr<Buffers> buffers_;
+  IItem::HashType hash_type_;
+  ContentHash::Pointer hash_;
+  uint64_t hashed_;
+  std::mutex mutex_;
+  std::shared_ptr<Chunk> current_;
+  std::future<std::shared_ptr<Chunk>> next_;
+};
+
+}  // namespace cloudstorage
+
+#endif  // CHUNKREADER_H
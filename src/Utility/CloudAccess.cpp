@@ -22,6 +22,7 @@
  *****************************************************************************/
 #include "CloudAccess.h"
 
+#include "Utility/Item.h"
 #include "Utility/Utility.h"
 
 #ifdef WITH_THUMBNAILER
@@ -31,6 +32,7 @@
 #include <json/json.h>
 #include <algorithm>
 #include <future>
+#include <unordered_map>
 
 namespace cloudstorage {
 
@@ -96,6 +98,45 @@ struct DownloadCallback : public IDownloadFileCallback {
   std::shared_ptr<priv::LoopImpl> loop_;
 };
 
+struct WalkCallback : public IWalkTreeCallback {
+  WalkCallback(IItem::Pointer root, ICloudAccess::WalkTreeCallback cb,
+               std::shared_ptr<SearchIndex> index, Promise<> promise,
+               uint64_t tag, std::shared_ptr<priv::LoopImpl> loop)
+      : callback_(std::move(cb)),
+        index_(std::move(index)),
+        directories_(std::make_shared<std::unordered_map<std::string,
+                                                         std::string>>()),
+        promise_(std::move(promise)),
+        tag_(tag),
+        loop_(std::move(loop)) {
+    (*directories_)[""] = root->id();
+  }
+
+  void receivedItem(const std::string& path, IItem::Pointer item) override {
+    loop_->invoke([callback = callback_, index = index_,
+                   directories = directories_, path, item] {
+      auto separator = path.find_last_of('/');
+      auto parent = directories->find(
+          separator == std::string::npos ? "" : path.substr(0, separator));
+      index->add(parent != directories->end() ? parent->second : "", item);
+      if (item->type() == IItem::FileType::Directory)
+        (*directories)[path] = item->id();
+      callback(path, item);
+    });
+  }
+
+  void done(EitherError<void> e) override {
+    loop_->fulfill(tag_, [promise = promise_, e] { fulfill(promise, e); });
+  }
+
+  ICloudAccess::WalkTreeCallback callback_;
+  std::shared_ptr<SearchIndex> index_;
+  std::shared_ptr<std::unordered_map<std::string, std::string>> directories_;
+  Promise<> promise_;
+  uint64_t tag_;
+  std::shared_ptr<priv::LoopImpl> loop_;
+};
+
 struct Uploader : public ICloudUploadCallback {
   Uploader(std::shared_ptr<std::istream> stream,
            ICloudAccess::ProgressCallback progress)
@@ -154,18 +195,28 @@ void fulfill(const Promise<>& promise, const EitherError<void>& e) {
 
 CloudAccess::CloudAccess(std::shared_ptr<priv::LoopImpl> loop,
                          ICloudProvider::Pointer&& provider)
-    : loop_(std::move(loop)), provider_(std::move(provider)) {}
+    : loop_(std::move(loop)),
+      provider_(std::move(provider)),
+      index_(std::make_shared<SearchIndex>()) {}
 
 Promise<GeneralData> CloudAccess::generalData() {
   return wrap(&ICloudProvider::getGeneralDataAsync);
 }
 
 Promise<IItem::List> CloudAccess::listDirectory(IItem::Pointer item) {
-  return wrap(&ICloudProvider::listDirectorySimpleAsync, item);
+  return wrap(&ICloudProvider::listDirectorySimpleAsync, item)
+      .then([index = index_, item](IItem::List list) {
+        index->update(item->id(), list);
+        return list;
+      });
 }
 
 Promise<IItem::Pointer> CloudAccess::getItem(const std::string& path) {
-  return wrap(&ICloudProvider::getItemAsync, path);
+  return wrap(&ICloudProvider::getItemAsync, path)
+      .then([index = index_](IItem::Pointer item) {
+        index->add("", item);
+        return item;
+      });
 }
 
 Promise<std::string> CloudAccess::getDaemonUrl(IItem::Pointer item) {
@@ -177,31 +228,95 @@ Promise<std::string> CloudAccess::getFileUrl(IItem::Pointer item) {
 }
 
 Promise<IItem::Pointer> CloudAccess::getItemData(const std::string& id) {
-  return wrap(&ICloudProvider::getItemDataAsync, id);
+  return wrap(&ICloudProvider::getItemDataAsync, id)
+      .then([index = index_](IItem::Pointer item) {
+        index->add("", item);
+        return item;
+      });
 }
 
 Promise<> CloudAccess::deleteItem(IItem::Pointer item) {
-  return wrap(&ICloudProvider::deleteItemAsync, item);
+  return wrap(&ICloudProvider::deleteItemAsync, item)
+      .then([index = index_, item] { index->remove(item->id()); });
 }
 
 Promise<IItem::Pointer> CloudAccess::createDirectory(
     IItem::Pointer parent, const std::string& filename) {
-  return wrap(&ICloudProvider::createDirectoryAsync, parent, filename);
+  return wrap(&ICloudProvider::createDirectoryAsync, parent, filename)
+      .then([index = index_, parent](IItem::Pointer item) {
+        index->add(parent->id(), item);
+        return item;
+      });
 }
 
 Promise<IItem::Pointer> CloudAccess::moveItem(IItem::Pointer item,
                                               IItem::Pointer new_parent) {
-  return wrap(&ICloudProvider::moveItemAsync, item, new_parent);
+  return wrap(&ICloudProvider::moveItemAsync, item, new_parent)
+      .then([index = index_, item, new_parent](IItem::Pointer moved) {
+        index->move(item->id(), new_parent->id(), moved);
+        return moved;
+      });
 }
 
 Promise<IItem::Pointer> CloudAccess::renameItem(IItem::Pointer item,
                                                 const std::string& new_name) {
-  return wrap(&ICloudProvider::renameItemAsync, item, new_name);
+  return wrap(&ICloudProvider::renameItemAsync, item, new_name)
+      .then([index = index_, item](IItem::Pointer renamed) {
+        index->replace(item->id(), renamed);
+        return renamed;
+      });
 }
 
 Promise<PageData> CloudAccess::listDirectoryPage(IItem::Pointer item,
                                                  const std::string& token) {
-  return wrap(&ICloudProvider::listDirectoryPageAsync, item, token);
+  return wrap(&ICloudProvider::listDirectoryPageAsync, item, token)
+      .then([index = index_, item](PageData page) {
+        for (const auto& d : page.items_) index->add(item->id(), d);
+        return page;
+      });
+}
+
+Promise<ChangeData> CloudAccess::listChanges(IItem::Pointer item,
+                                             const std::string& cursor) {
+  return wrap(&ICloudProvider::listChangesAsync, item, cursor)
+      .then([index = index_](ChangeData changes) {
+        for (const auto& id : changes.deleted_) index->remove(id);
+        for (const auto& d : changes.items_) {
+          const auto& parents = static_cast<const Item*>(d.get())->parents();
+          index->add(parents.empty() ? "" : parents.front(), d);
+        }
+        return changes;
+      });
+}
+
+Promise<> CloudAccess::walkTree(IItem::Pointer root, WalkTreeCallback callback,
+                                WalkTreeOptions options) {
+  Promise<> promise;
+  auto tag = promise.id();
+  auto request = provider_->walkTreeAsync(
+      root,
+      std::make_shared<WalkCallback>(root, std::move(callback), index_,
+                                     promise, tag, loop_),
+      std::move(options));
+  promise.cancel([tag, loop = loop_] { loop->cancel(tag); });
+  loop_->add(tag, std::move(request));
+  return promise;
+}
+
+Promise<IItem::List> CloudAccess::search(const std::string& query) {
+  Promise<IItem::List> promise;
+  loop_->invoke([promise, index = index_, query] {
+    promise.fulfill(index->search(query));
+  });
+  return promise;
+}
+
+void CloudAccess::dumpSearchIndex(std::ostream& stream) const {
+  index_->dump(stream);
+}
+
+bool CloudAccess::loadSearchIndex(std::istream& stream) {
+  return index_->load(stream);
 }
 
 Promise<IItem::Pointer> CloudAccess::uploadFile(
@@ -213,7 +328,10 @@ Promise<IItem::Pointer> CloudAccess::uploadFile(
       parent, filename,
       util::make_unique<UploadCallback>(cb, promise, tag, loop_));
   loop_->add(tag, std::move(request));
-  return promise;
+  return promise.then([index = index_, parent](IItem::Pointer item) {
+    index->add(parent->id(), item);
+    return item;
+  });
 }
 
 Promise<> CloudAccess::downloadFile(
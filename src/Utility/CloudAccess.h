@@ -26,6 +26,7 @@
 #include "CloudEventLoop.h"
 #include "ICloudAccess.h"
 #include "ICloudProvider.h"
+#include "SearchIndex.h"
 
 namespace cloudstorage {
 
@@ -108,6 +109,11 @@ class CloudAccess : public ICloudAccess {
                                      const std::string& new_name) override;
   Promise<PageData> listDirectoryPage(IItem::Pointer item,
                                       const std::string& token) override;
+  Promise<ChangeData> listChanges(IItem::Pointer item,
+                                  const std::string& cursor) override;
+  Promise<> walkTree(IItem::Pointer root, WalkTreeCallback callback,
+                     WalkTreeOptions options) override;
+  Promise<IItem::List> search(const std::string& query) override;
   Promise<IItem::Pointer> uploadFile(
       IItem::Pointer parent, const std::string& filename,
       const std::shared_ptr<ICloudUploadCallback>&) override;
@@ -121,6 +127,9 @@ class CloudAccess : public ICloudAccess {
       IItem::Pointer file,
       const std::shared_ptr<ICloudDownloadCallback>&) override;
 
+  void dumpSearchIndex(std::ostream&) const override;
+  bool loadSearchIndex(std::istream&) override;
+
  private:
   template <
       typename Method,
@@ -144,6 +153,7 @@ class CloudAccess : public ICloudAccess {
 
   std::shared_ptr<priv::LoopImpl> loop_;
   std::shared_ptr<ICloudProvider> provider_;
+  std::shared_ptr<SearchIndex> index_;
 };
 
 }  // namespace cloudstorage
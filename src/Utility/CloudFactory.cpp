@@ -79,6 +79,22 @@ struct ThreadPoolWrapper : public IThreadPool {
   std::shared_ptr<IThreadPool> thread_pool_;
 };
 
+struct LazyThreadPool : public IThreadPool {
+  LazyThreadPool(std::shared_ptr<IThreadPoolFactory> factory)
+      : factory_(std::move(factory)) {}
+
+  void schedule(const Task& f,
+                const std::chrono::system_clock::time_point& when) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!thread_pool_) thread_pool_ = factory_->create(1);
+    thread_pool_->schedule(f, when);
+  }
+
+  std::mutex mutex_;
+  std::shared_ptr<IThreadPoolFactory> factory_;
+  IThreadPool::Pointer thread_pool_;
+};
+
 struct AuthCallback : public ICloudProvider::IAuthCallback {
   AuthCallback(CloudFactory* factory) : factory_(factory) {}
 
@@ -223,6 +239,7 @@ CloudFactory::CloudFactory(CloudFactory::InitData&& d)
       crypto_(std::move(d.crypto_)),
       thread_pool_(d.thread_pool_factory_->create(1)),
       thread_pool_factory_(std::move(d.thread_pool_factory_)),
+      hash_thread_pool_(std::make_shared<LazyThreadPool>(thread_pool_factory_)),
       cloud_storage_(ICloudStorage::create()),
       loop_(event_loop_.impl()) {
   for (const auto& d : cloud_storage_->providers()) {
@@ -242,6 +259,7 @@ CloudFactory::~CloudFactory() {
   http_server_factory_ = nullptr;
   crypto_ = nullptr;
   thread_pool_ = nullptr;
+  hash_thread_pool_ = nullptr;
   thread_pool_factory_ = nullptr;
   http_ = nullptr;
   http_server_handles_.clear();
@@ -287,6 +305,10 @@ std::unique_ptr<CloudAccess> CloudFactory::createImpl(
   init_data.thread_pool_ =
       thread_pool_ ? util::make_unique<ThreadPoolWrapper>(thread_pool_)
                    : nullptr;
+  init_data.hash_thread_pool_ =
+      hash_thread_pool_
+          ? util::make_unique<ThreadPoolWrapper>(hash_thread_pool_)
+          : nullptr;
   init_data.callback_ =
       util::make_unique<AuthCallback>(const_cast<CloudFactory*>(this));
   auto auth_callback = static_cast<AuthCallback*>(init_data.callback_.get());
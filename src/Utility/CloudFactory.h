@@ -95,7 +95,8 @@ class CloudFactory : public ICloudFactory {
   std::shared_ptr<ServerWrapperFactory> http_server_factory_;
   std::shared_ptr<ICrypto> crypto_;
   std::shared_ptr<IThreadPool> thread_pool_;
-  std::unique_ptr<IThreadPoolFactory> thread_pool_factory_;
+  std::shared_ptr<IThreadPoolFactory> thread_pool_factory_;
+  std::shared_ptr<IThreadPool> hash_thread_pool_;
   ICloudStorage::Pointer cloud_storage_;
   std::vector<IHttpServer::Pointer> http_server_handles_;
   std::unordered_set<std::shared_ptr<CloudAccess>> cloud_access_;
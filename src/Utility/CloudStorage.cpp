@@ -102,12 +102,29 @@ class CloudProviderWrapper : public ICloudProvider {
     return p_->downloadFileAsync(item, cb, range);
   }
 
+  DownloadFileRequest::Pointer downloadFileSegmentedAsync(
+      IItem::Pointer item, IDownloadFileCallback::Pointer cb,
+      SegmentedDownloadOptions options) override {
+    return p_->downloadFileSegmentedAsync(item, cb, options);
+  }
+
   UploadFileRequest::Pointer uploadFileAsync(
       IItem::Pointer parent, const std::string& filename,
       IUploadFileCallback::Pointer cb) override {
     return p_->uploadFileAsync(parent, filename, cb);
   }
 
+  UploadFileRequest::Pointer resumeUploadAsync(
+      const std::string& state, IUploadFileCallback::Pointer cb) override {
+    return p_->resumeUploadAsync(state, cb);
+  }
+
+  UploadFileRequest::Pointer uploadFileIfChangedAsync(
+      IItem::Pointer parent, const std::string& filename,
+      IUploadFileCallback::Pointer cb) override {
+    return p_->uploadFileIfChangedAsync(parent, filename, cb);
+  }
+
   GetItemDataRequest::Pointer getItemDataAsync(
       const std::string& id, GetItemDataCallback callback) override {
     return p_->getItemDataAsync(id, callback);
@@ -135,6 +152,13 @@ class CloudProviderWrapper : public ICloudProvider {
     return p_->moveItemAsync(source, destination, callback);
   }
 
+  CopyItemRequest::Pointer copyItemAsync(IItem::Pointer source,
+                                         std::shared_ptr<ICloudProvider> dest,
+                                         IItem::Pointer parent,
+                                         CopyItemCallback callback) override {
+    return p_->copyItemAsync(source, dest, parent, callback);
+  }
+
   RenameItemRequest::Pointer renameItemAsync(
       IItem::Pointer item, const std::string& name,
       RenameItemCallback callback) override {
@@ -158,6 +182,12 @@ class CloudProviderWrapper : public ICloudProvider {
     return p_->downloadFileAsync(item, filename, callback);
   }
 
+  DownloadFileRequest::Pointer downloadToFileAsync(
+      IItem::Pointer item, const std::string& path,
+      DownloadFileCallback callback, DownloadToFileOptions options) override {
+    return p_->downloadToFileAsync(item, path, callback, options);
+  }
+
   DownloadFileRequest::Pointer getThumbnailAsync(
       IItem::Pointer item, const std::string& filename,
       GetThumbnailCallback callback) override {
@@ -180,6 +210,18 @@ class CloudProviderWrapper : public ICloudProvider {
     return p_->getFileDaemonUrlAsync(item, callback);
   }
 
+  ListChangesRequest::Pointer listChangesAsync(
+      IItem::Pointer directory, const std::string& cursor,
+      ListChangesCallback callback) override {
+    return p_->listChangesAsync(directory, cursor, callback);
+  }
+
+  WalkTreeRequest::Pointer walkTreeAsync(IItem::Pointer root,
+                                         IWalkTreeCallback::Pointer callback,
+                                         WalkTreeOptions options) override {
+    return p_->walkTreeAsync(root, callback, options);
+  }
+
  private:
   std::shared_ptr<CloudProvider> p_;
 };
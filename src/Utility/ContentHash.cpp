@@ -0,0 +1,371 @@
+/*****************************************************************************
+ * ContentHash.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "ContentHash.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "Utility/Utility.h"
+
+namespace cloudstorage {
+
+namespace {
+
+const size_t DROPBOX_BLOCK_SIZE = 4 * 1024 * 1024;
+const size_t QUICKXOR_WIDTH = 160;
+const size_t QUICKXOR_SHIFT = 11;
+
+uint32_t rotl(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+uint32_t big_endian(const uint8_t* data) {
+  return uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 |
+         uint32_t(data[2]) << 8 | uint32_t(data[3]);
+}
+
+std::string to_hex(const uint8_t* data, size_t length) {
+  const char* digits = "0123456789abcdef";
+  std::string result;
+  for (size_t i = 0; i < length; i++) {
+    result += digits[data[i] >> 4];
+    result += digits[data[i] & 15];
+  }
+  return result;
+}
+
+class BlockHash : public ContentHash {
+ public:
+  void update(const char* data, size_t length) override {
+    auto input = reinterpret_cast<const uint8_t*>(data);
+    length_ += length;
+    if (used_ > 0) {
+      auto count = std::min(length, block_.size() - used_);
+      memcpy(block_.data() + used_, input, count);
+      used_ += count;
+      input += count;
+      length -= count;
+      if (used_ < block_.size()) return;
+      transform(block_.data());
+      used_ = 0;
+    }
+    for (; length >= block_.size(); length -= block_.size()) {
+      transform(input);
+      input += block_.size();
+    }
+    memcpy(block_.data(), input, length);
+    used_ = length;
+  }
+
+ protected:
+  virtual void transform(const uint8_t* block) = 0;
+
+  // appends padding ending with message length in bits
+  void finish(bool big_endian) {
+    uint64_t bits = length_ * 8;
+    uint8_t padding[72] = {0x80};
+    size_t count = (used_ < 56 ? 56 : 120) - used_;
+    for (size_t i = 0; i < 8; i++)
+      padding[count + i] =
+          static_cast<uint8_t>(bits >> (big_endian ? 56 - 8 * i : 8 * i));
+    update(reinterpret_cast<const char*>(padding), count + 8);
+  }
+
+ private:
+  uint64_t length_ = 0;
+  std::array<uint8_t, 64> block_;
+  size_t used_ = 0;
+};
+
+class MD5 : public BlockHash {
+ public:
+  std::string digest() override {
+    finish(false);
+    uint8_t result[16];
+    for (size_t i = 0; i < 16; i++)
+      result[i] = static_cast<uint8_t>(state_[i / 4] >> (8 * (i % 4)));
+    return to_hex(result, sizeof(result));
+  }
+
+ private:
+  void transform(const uint8_t* block) override {
+    static const uint32_t K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+        0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+        0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+        0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+        0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+        0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+        0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+        0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+        0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+    static const int S[16] = {7, 12, 17, 22, 5, 9,  14, 20,
+                              4, 11, 16, 23, 6, 10, 15, 21};
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; i++)
+      m[i] = uint32_t(block[4 * i]) | uint32_t(block[4 * i + 1]) << 8 |
+             uint32_t(block[4 * i + 2]) << 16 |
+             uint32_t(block[4 * i + 3]) << 24;
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    for (int i = 0; i < 64; i++) {
+      uint32_t f;
+      int g;
+      if (i < 16) {
+        f = (b & c) | (~b & d);
+        g = i;
+      } else if (i < 32) {
+        f = (d & b) | (~d & c);
+        g = (5 * i + 1) % 16;
+      } else if (i < 48) {
+        f = b ^ c ^ d;
+        g = (3 * i + 5) % 16;
+      } else {
+        f = c ^ (b | ~d);
+        g = (7 * i) % 16;
+      }
+      f += a + K[i] + m[g];
+      a = d;
+      d = c;
+      c = b;
+      b += rotl(f, S[i / 16 * 4 + i % 4]);
+    }
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+  }
+
+  uint32_t state_[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+};
+
+class SHA1 : public BlockHash {
+ public:
+  std::string digest() override {
+    finish(true);
+    uint8_t result[20];
+    for (size_t i = 0; i < 20; i++)
+      result[i] = static_cast<uint8_t>(state_[i / 4] >> (24 - 8 * (i % 4)));
+    return to_hex(result, sizeof(result));
+  }
+
+ private:
+  void transform(const uint8_t* block) override {
+    uint32_t w[80];
+    for (size_t i = 0; i < 16; i++) w[i] = big_endian(block + 4 * i);
+    for (size_t i = 16; i < 80; i++)
+      w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3],
+             e = state_[4];
+    for (size_t i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5a827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ed9eba1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8f1bbcdc;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xca62c1d6;
+      }
+      uint32_t t = rotl(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = rotl(b, 30);
+      b = a;
+      a = t;
+    }
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+  }
+
+  uint32_t state_[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476,
+                        0xc3d2e1f0};
+};
+
+class SHA256 : public BlockHash {
+ public:
+  std::array<uint8_t, 32> raw() {
+    finish(true);
+    std::array<uint8_t, 32> result;
+    for (size_t i = 0; i < result.size(); i++)
+      result[i] = static_cast<uint8_t>(state_[i / 4] >> (24 - 8 * (i % 4)));
+    return result;
+  }
+
+  std::string digest() override {
+    auto result = raw();
+    return to_hex(result.data(), result.size());
+  }
+
+ private:
+  void transform(const uint8_t* block) override {
+    static const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+        0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+        0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+        0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+        0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+    uint32_t w[64];
+    for (size_t i = 0; i < 16; i++) w[i] = big_endian(block + 4 * i);
+    for (size_t i = 16; i < 64; i++) {
+      uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t s[8];
+    std::copy(std::begin(state_), std::end(state_), s);
+    for (size_t i = 0; i < 64; i++) {
+      uint32_t t1 = s[7] + (rotr(s[4], 6) ^ rotr(s[4], 11) ^ rotr(s[4], 25)) +
+                    ((s[4] & s[5]) ^ (~s[4] & s[6])) + K[i] + w[i];
+      uint32_t t2 = (rotr(s[0], 2) ^ rotr(s[0], 13) ^ rotr(s[0], 22)) +
+                    ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+      std::copy_backward(s, s + 7, s + 8);
+      s[4] += t1;
+      s[0] = t1 + t2;
+    }
+    for (size_t i = 0; i < 8; i++) state_[i] += s[i];
+  }
+
+  uint32_t state_[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+};
+
+// SHA256 of concatenated SHA256 hashes of 4 MiB blocks
+class DropboxContentHash : public ContentHash {
+ public:
+  void update(const char* data, size_t length) override {
+    while (length > 0) {
+      auto count = std::min(length, DROPBOX_BLOCK_SIZE - block_length_);
+      block_.update(data, count);
+      block_length_ += count;
+      data += count;
+      length -= count;
+      if (block_length_ == DROPBOX_BLOCK_SIZE) flush();
+    }
+  }
+
+  std::string digest() override {
+    if (block_length_ > 0) flush();
+    return hash_.digest();
+  }
+
+ private:
+  void flush() {
+    auto block_hash = block_.raw();
+    hash_.update(reinterpret_cast<const char*>(block_hash.data()),
+                 block_hash.size());
+    block_ = SHA256();
+    block_length_ = 0;
+  }
+
+  SHA256 hash_;
+  SHA256 block_;
+  size_t block_length_ = 0;
+};
+
+// OneDrive's hash: bytes are xored into a 160 bit circular buffer, each one
+// shifted 11 bits further than the previous one; the length is xored into the
+// last 64 bits
+class QuickXorHash : public ContentHash {
+ public:
+  void update(const char* data, size_t length) override {
+    // bytes QUICKXOR_WIDTH apart land on the same bits, so they are folded
+    // first; that loop is trivially vectorized by the compiler and leaves at
+    // most QUICKXOR_WIDTH bytes to be shifted into place
+    std::array<uint8_t, QUICKXOR_WIDTH> folded = {};
+    auto input = reinterpret_cast<const uint8_t*>(data);
+    size_t offset = 0;
+    for (; offset + QUICKXOR_WIDTH <= length; offset += QUICKXOR_WIDTH)
+      for (size_t i = 0; i < QUICKXOR_WIDTH; i++)
+        folded[i] ^= input[offset + i];
+    for (size_t i = 0; offset + i < length; i++) folded[i] ^= input[offset + i];
+    for (size_t i = 0; i < std::min(length, QUICKXOR_WIDTH); i++) {
+      auto bit = (shift_ + QUICKXOR_SHIFT * i) % QUICKXOR_WIDTH;
+      auto index = bit / 8;
+      state_[index] ^= static_cast<uint8_t>(folded[i] << (bit % 8));
+      if (bit % 8 != 0)
+        state_[(index + 1) % state_.size()] ^=
+            static_cast<uint8_t>(folded[i] >> (8 - bit % 8));
+    }
+    shift_ = (shift_ + QUICKXOR_SHIFT * (length % QUICKXOR_WIDTH)) %
+             QUICKXOR_WIDTH;
+    length_ += length;
+  }
+
+  std::string digest() override {
+    auto result = state_;
+    for (size_t i = 0; i < 8; i++)
+      result[result.size() - 8 + i] ^=
+          static_cast<uint8_t>(length_ >> (8 * i));
+    return util::to_base64(std::string(result.begin(), result.end()));
+  }
+
+ private:
+  std::array<uint8_t, QUICKXOR_WIDTH / 8> state_ = {};
+  size_t shift_ = 0;
+  uint64_t length_ = 0;
+};
+
+}  // namespace
+
+ContentHash::Pointer ContentHash::create(IItem::HashType type) {
+  switch (type) {
+    case IItem::HashType::MD5:
+      return util::make_unique<MD5>();
+    case IItem::HashType::SHA1:
+      return util::make_unique<SHA1>();
+    case IItem::HashType::DropboxContentHash:
+      return util::make_unique<DropboxContentHash>();
+    case IItem::HashType::QuickXorHash:
+      return util::make_unique<QuickXorHash>();
+    default:
+      return nullptr;
+  }
+}
+
+bool ContentHash::matches(const IItem& item, IItem::HashType type,
+                          const std::string& digest) {
+  auto hash = item.hash();
+  if (item.hash_type() != type || hash.empty() || digest.empty()) return true;
+  if (type == IItem::HashType::QuickXorHash) return hash == digest;
+  return util::to_lower(hash) == digest;
+}
+
+}  // namespace cloudstorage
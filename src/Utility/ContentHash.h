@@ -0,0 +1,68 @@
+/*****************************************************************************
+ * ContentHash.h
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "IItem.h"
+
+namespace cloudstorage {
+
+/**
+ * Incrementally computes content hash of a file in the representation used by
+ * providers, so that transferred data can be verified without reading it
+ * again.
+ */
+class CLOUDSTORAGE_API ContentHash {
+ public:
+  using Pointer = std::unique_ptr<ContentHash>;
+
+  virtual ~ContentHash() = default;
+
+  virtual void update(const char* data, size_t length) = 0;
+
+  /**
+   * @return hash of data passed so far, hex string or base64 for
+   * QuickXorHash
+   */
+  virtual std::string digest() = 0;
+
+  /**
+   * @return hash of given type, nullptr for IItem::HashType::None
+   */
+  static Pointer create(IItem::HashType);
+
+  /**
+   * Compares digest with hash reported for the item; data is considered valid
+   * if the item doesn't carry hash of the type.
+   */
+  static bool matches(const IItem&, IItem::HashType, const std::string& digest);
+};
+
+}  // namespace cloudstorage
+
+#endif  // CONTENTHASH_H
@@ -78,6 +78,17 @@ size_t read_callback(char* buffer, size_t size, size_t nmemb, void* userdata) {
   auto data = static_cast<RequestData*>(userdata);
   auto stream = data->data_.get();
   stream->read(buffer, size * nmemb);
+  if (stream->gcount() == 0 && data->callback_) {
+    // a paused request whose source has nothing yet waits for more data;
+    // read again in case it came after the first attempt
+    bool paused = data->callback_->pause();
+    stream->clear();
+    stream->read(buffer, size * nmemb);
+    if (stream->gcount() == 0 && paused) {
+      stream->clear();
+      return CURL_READFUNC_PAUSE;
+    }
+  }
   return stream->gcount();
 }
 
@@ -25,39 +25,68 @@
 #include <json/json.h>
 
 #include <algorithm>
-#include <queue>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
 
 #include "Utility/Item.h"
 
 namespace cloudstorage {
 
 const int CHUNK_SIZE = 8 * 1024 * 1024;
-const int CACHE_SIZE = 128;
+const size_t CACHE_SHARDS = 4;
+const size_t MIN_PREFETCH = 2;
+const size_t MAX_PREFETCH = 6;
+const size_t MAX_RANGES = 32;
+const auto BOUNDARY = "CLOUDSTORAGE_BYTERANGES";
 
 namespace {
 
 struct Buffer;
+struct Block;
+class BlockCache;
+struct Metrics;
+struct Connection;
 using Cache = util::LRUCache<std::string, IItem>;
 
 class HttpServerCallback : public IHttpServer::ICallback {
  public:
-  HttpServerCallback(std::shared_ptr<CloudProvider>);
+  HttpServerCallback(std::shared_ptr<CloudProvider>,
+                     const FileServer::Options&);
   IHttpServer::IResponse::Pointer handle(const IHttpServer::IRequest&) override;
 
  private:
+  IHttpServer::IResponse::Pointer metrics(const IHttpServer::IRequest&);
+  IHttpServer::IResponse::ICallback::Pointer stream(
+      const std::string& id, const std::string& key, Range,
+      const std::shared_ptr<Connection>&);
+
   std::shared_ptr<Cache> item_cache_;
+  std::shared_ptr<BlockCache> block_cache_;
+  std::shared_ptr<Metrics> metrics_;
   std::shared_ptr<CloudProvider> provider_;
 };
 
 class HttpDataCallback : public IDownloadFileCallback {
  public:
-  HttpDataCallback(std::shared_ptr<Buffer> d) : buffer_(std::move(d)) {}
+  HttpDataCallback(std::shared_ptr<CloudProvider> p,
+                   std::shared_ptr<BlockCache> cache,
+                   std::shared_ptr<Metrics> metrics, std::shared_ptr<Block> b)
+      : provider_(std::move(p)),
+        cache_(std::move(cache)),
+        metrics_(std::move(metrics)),
+        block_(std::move(b)) {}
 
   void receivedData(const char* data, uint32_t length) override;
   void done(EitherError<void> e) override;
   void progress(uint64_t, uint64_t) override {}
 
-  std::shared_ptr<Buffer> buffer_;
+  std::shared_ptr<CloudProvider> provider_;
+  std::shared_ptr<BlockCache> cache_;
+  std::shared_ptr<Metrics> metrics_;
+  std::shared_ptr<Block> block_;
 };
 
 class StreamRequest : public Request<EitherError<void>> {
@@ -93,32 +122,279 @@ class StreamRequest : public Request<EitherError<void>> {
   std::mutex mutex_;
 };
 
+// Aligned part of a file, downloaded once and shared by every stream which
+// reads it. The download appends data and readers copy out of the filled
+// part, synchronizing only through size_ and state_. The download belongs to
+// the block and is cancelled only once no stream reads it.
+struct Block {
+  using Pointer = std::shared_ptr<Block>;
+
+  static constexpr int InProgress = 0;
+  static constexpr int Done = 1;
+  static constexpr int Failed = 2;
+
+  Block(std::string key, Range range)
+      : key_(std::move(key)),
+        range_(range),
+        data_(new char[range.size_]),
+        start_(std::chrono::steady_clock::now()) {}
+
+  bool append(const char* data, uint32_t length) {
+    auto size = size_.load(std::memory_order_relaxed);
+    if (size + length > range_.size_) return false;
+    memcpy(data_.get() + size, data, length);
+    size_.store(size + length, std::memory_order_release);
+    return true;
+  }
+
+  void listen(const std::shared_ptr<Buffer>& buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    listeners_.erase(
+        std::remove_if(listeners_.begin(), listeners_.end(),
+                       [](const std::weak_ptr<Buffer>& b) {
+                         return b.expired();
+                       }),
+        listeners_.end());
+    listeners_.push_back(buffer);
+    readers_++;
+  }
+
+  // Returns the download to cancel if the last reader went away before it
+  // finished.
+  std::shared_ptr<IGenericRequest> release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--readers_ > 0 || state_ != InProgress) return nullptr;
+    return std::move(request_);
+  }
+
+  // Returns the request back if the download has already finished.
+  std::shared_ptr<IGenericRequest> set_request(
+      std::shared_ptr<IGenericRequest> request) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_ != InProgress) return request;
+    request_ = std::move(request);
+    return nullptr;
+  }
+
+  // Returns the finished download, which can't be destroyed from its own
+  // callback.
+  std::shared_ptr<IGenericRequest> finish(int state) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    state_ = state;
+    return std::move(request_);
+  }
+
+  std::vector<std::shared_ptr<Buffer>> listeners() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::shared_ptr<Buffer>> result;
+    for (const auto& l : listeners_)
+      if (auto buffer = l.lock()) result.push_back(buffer);
+    return result;
+  }
+
+  std::string key_;
+  Range range_;
+  std::unique_ptr<char[]> data_;
+  std::chrono::steady_clock::time_point start_;
+  std::atomic<uint64_t> size_{0};
+  std::atomic_int state_{InProgress};
+  Error error_;
+  std::mutex mutex_;
+  std::vector<std::weak_ptr<Buffer>> listeners_;
+  size_t readers_ = 0;
+  std::shared_ptr<IGenericRequest> request_;
+};
+
+// Blocks of all the files served by one provider; a block which is still
+// being downloaded is handed out as well, so that concurrent streams of the
+// same range share a single download.
+class BlockCache {
+ public:
+  BlockCache(size_t size)
+      : blocks_(size, [](const Block& b) { return b.range_.size_; }) {}
+
+  // Returns the block of the file version identified by file_key which starts
+  // at offset and whether the caller is responsible for downloading it.
+  std::pair<Block::Pointer, bool> get(const std::string& file_key,
+                                      uint64_t offset, uint64_t size) {
+    auto key = file_key + ":" + std::to_string(offset);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto block = blocks_.get(key);
+    if (block) {
+      hits_++;
+      return {block, false};
+    }
+    misses_++;
+    block = std::make_shared<Block>(
+        key, Range{offset, std::min<uint64_t>(size - offset, CHUNK_SIZE)});
+    blocks_.put(key, block);
+    return {block, true};
+  }
+
+  void remove(const Block& block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (blocks_.get(block.key_).get() == &block) blocks_.erase(block.key_);
+  }
+
+  size_t size() const { return blocks_.size(); }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+ private:
+  std::mutex mutex_;
+  util::LRUCache<std::string, Block> blocks_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+// Counters of one file server, exposed at /metrics in the Prometheus text
+// format.
+struct Metrics {
+  static constexpr double FetchBuckets[] = {0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+  static constexpr size_t FetchBucketCount =
+      sizeof(FetchBuckets) / sizeof(FetchBuckets[0]);
+
+  void add(const std::shared_ptr<Buffer>& stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_.erase(std::remove_if(streams_.begin(), streams_.end(),
+                                  [](const std::weak_ptr<Buffer>& b) {
+                                    return b.expired();
+                                  }),
+                   streams_.end());
+    streams_.push_back(stream);
+  }
+
+  std::vector<std::shared_ptr<Buffer>> streams() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::shared_ptr<Buffer>> result;
+    for (const auto& s : streams_)
+      if (auto buffer = s.lock()) result.push_back(buffer);
+    return result;
+  }
+
+  void fetched(std::chrono::steady_clock::duration duration) {
+    auto seconds = std::chrono::duration<double>(duration).count();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < FetchBucketCount; i++)
+      if (seconds <= FetchBuckets[i]) fetch_buckets_[i]++;
+    fetch_count_++;
+    fetch_sum_ += seconds;
+  }
+
+  std::atomic<uint64_t> bytes_served_{0};
+  std::atomic<uint64_t> stalls_{0};
+  std::atomic<uint64_t> upstream_errors_{0};
+  std::mutex mutex_;
+  std::vector<std::weak_ptr<Buffer>> streams_;
+  uint64_t fetch_buckets_[FetchBucketCount] = {};
+  uint64_t fetch_count_ = 0;
+  double fetch_sum_ = 0;
+};
+
+// Response streams write to, cleared once the server is done with it.
+struct Connection {
+  void resume() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (response_) response_->resume();
+  }
+
+  void set(IHttpServer::IResponse* response) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    response_ = response;
+  }
+
+  std::mutex mutex_;
+  IHttpServer::IResponse* response_ = nullptr;
+};
+
 struct Buffer : public std::enable_shared_from_this<Buffer> {
   using Pointer = std::shared_ptr<Buffer>;
 
+  Buffer(std::shared_ptr<CloudProvider> provider,
+         std::shared_ptr<BlockCache> cache, std::shared_ptr<Metrics> metrics,
+         std::shared_ptr<Connection> connection, std::string key)
+      : provider_(std::move(provider)),
+        cache_(std::move(cache)),
+        metrics_(std::move(metrics)),
+        connection_(std::move(connection)),
+        key_(std::move(key)) {}
+
   int read(char* buf, uint32_t max) {
-    if (2 * size() < CHUNK_SIZE) {
-      std::unique_lock<std::mutex> lock(delayed_mutex_);
-      if (delayed_) {
-        delayed_ = false;
-        lock.unlock();
-        run_download();
+    while (true) {
+      if (abort_) return IHttpServer::IResponse::ICallback::Abort;
+      auto block = front();
+      if (!block) return IHttpServer::IResponse::ICallback::Suspend;
+      int state = block->state_;
+      auto available = block->size_.load(std::memory_order_acquire);
+      auto offset = position_ - block->range_.start_;
+      auto end = std::min(end_ - block->range_.start_, block->range_.size_);
+      if (offset < std::min(available, end)) {
+        auto cnt =
+            std::min<uint64_t>(std::min(available, end) - offset, max);
+        memcpy(buf, block->data_.get() + offset, cnt);
+        position_ += cnt;
+        metrics_->bytes_served_ += cnt;
+        std::lock_guard<std::mutex> lock(mutex_);
+        consumed_ += cnt;
+        return static_cast<int>(cnt);
+      }
+      if (offset >= end) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          blocks_.erase(blocks_.begin());
+        }
+        release(block);
+        prefetch();
+      } else if (state == Block::Failed) {
+        if (block->error_.code_ != IHttpRequest::Aborted) {
+          done(block->error_);
+          return IHttpServer::IResponse::ICallback::Abort;
+        }
+        // Nobody read the block for a moment and its download was cancelled.
+        auto b = acquire(block->range_.start_);
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          blocks_[block->range_.start_] = b;
+        }
+        release(block);
+      } else if (state == Block::Done) {
+        done(Error{IHttpRequest::Failure, util::Error::INCOMPLETE_SEGMENT});
+        return IHttpServer::IResponse::ICallback::Abort;
+      } else {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stalled_ = true;
+        metrics_->stalls_++;
+        return IHttpServer::IResponse::ICallback::Suspend;
       }
     }
-    std::unique_lock<std::mutex> lock(mutex_);
-    if (abort_) return IHttpServer::IResponse::ICallback::Abort;
-    if (data_.empty()) return IHttpServer::IResponse::ICallback::Suspend;
-    size_t cnt = std::min<size_t>(data_.size(), static_cast<size_t>(max));
-    for (size_t i = 0; i < cnt; i++) {
-      buf[i] = data_.front();
-      data_.pop();
+  }
+
+  void start(IItem::Pointer item, Range range) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      item_ = std::move(item);
+      position_ = range.start_;
+      next_ = range.start_ - range.start_ % CHUNK_SIZE;
+      end_ = range.start_ + range.size_;
+      start_ = std::chrono::steady_clock::now();
     }
-    return static_cast<int>(cnt);
+    prefetch();
   }
 
-  void put(const char* data, uint32_t length) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (uint32_t i = 0; i < length; i++) data_.push(data[i]);
+  void received(const Block& block) {
+    if (front().get() == &block) resume();
+  }
+
+  void block_done(const Block::Pointer& block, const EitherError<void>& e) {
+    if (e.left()) {
+      if (e.left()->code_ != IHttpRequest::Aborted) done(e);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      adapt(*block);
+    }
+    prefetch();
   }
 
   void done(const EitherError<void>& e) {
@@ -135,56 +411,154 @@ struct Buffer : public std::enable_shared_from_this<Buffer> {
     }
   }
 
-  void resume() {
-    std::lock_guard<std::mutex> lock(response_mutex_);
-    if (response_) response_->resume();
-  }
+  void resume() { connection_->resume(); }
 
-  std::size_t size() {
+  Block::Pointer front() {
     std::lock_guard<std::mutex> lock(mutex_);
-    return data_.size();
-  }
-
-  void continue_download(const EitherError<void>& e) {
-    if (e.left() || range_.size_ < CHUNK_SIZE) return done(e);
-    range_.size_ -= CHUNK_SIZE;
-    range_.start_ += CHUNK_SIZE;
-    if (2 * size() < CHUNK_SIZE)
-      run_download();
-    else {
-      std::unique_lock<std::mutex> lock(delayed_mutex_);
-      delayed_ = true;
+    return blocks_.empty() ? nullptr : blocks_.begin()->second;
+  }
+
+  // Takes the block at offset from the cache, downloading it if nobody else
+  // does.
+  Block::Pointer acquire(uint64_t offset) {
+    auto result = cache_->get(key_, offset, item_->size());
+    auto block = result.first;
+    block->listen(shared_from_this());
+    if (result.second)
+      dispose(block->set_request(provider_->downloadFileRangeAsync(
+          item_, block->range_,
+          util::make_unique<HttpDataCallback>(provider_, cache_, metrics_,
+                                              block))));
+    return block;
+  }
+
+  void release(const Block::Pointer& block) {
+    if (auto request = block->release())
+      provider_->thread_pool()->schedule([request] { request->cancel(); });
+  }
+
+  // Lets go of all the blocks, once the stream is over.
+  void release() {
+    std::map<uint64_t, Block::Pointer> blocks;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      blocks.swap(blocks_);
+    }
+    for (const auto& b : blocks)
+      if (b.second) release(b.second);
+  }
+
+  // Requests wait for their callbacks to return when destroyed, so they're
+  // let go of on another thread.
+  void dispose(std::shared_ptr<IGenericRequest> request) {
+    if (request) provider_->thread_pool()->schedule([request] {});
+  }
+
+  // Keeps window_ blocks either downloading or waiting to be read; the slot
+  // is reserved first, as prefetch runs both on the reader's and on the
+  // download's thread.
+  void prefetch() {
+    while (true) {
+      uint64_t offset;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (abort_ || blocks_.size() >= window_ || next_ >= end_) return;
+        offset = next_;
+        next_ += CHUNK_SIZE;
+        blocks_[offset] = nullptr;
+      }
+      auto block = acquire(offset);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = blocks_.find(offset);
+        if (it != blocks_.end()) {
+          it->second = block;
+          block = nullptr;
+        }
+      }
+      // the stream was released in the meantime
+      if (block) release(block);
+      resume();
     }
   }
 
-  void run_download() {
-    request_->make_subrequest(
-        &CloudProvider::downloadFileRangeAsync, item_,
-        Range{range_.start_, std::min<uint64_t>(range_.size_, CHUNK_SIZE)},
-        util::make_unique<HttpDataCallback>(shared_from_this()));
+  // Sizes the window so that the blocks downloading in parallel keep up with
+  // the rate at which the client reads; grows it whenever the client had to
+  // wait for data.
+  void adapt(const Block& block) {
+    auto now = std::chrono::steady_clock::now();
+    auto rate = [=](uint64_t bytes, std::chrono::steady_clock::time_point t) {
+      auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - t);
+      return static_cast<double>(bytes) / std::max<int64_t>(ms.count(), 1);
+    };
+    auto download_rate = rate(block.range_.size_, block.start_);
+    download_rate_ = download_rate_ == 0
+                         ? download_rate
+                         : (download_rate_ + download_rate) / 2;
+    auto ratio = rate(consumed_, start_) / download_rate_;
+    auto window = static_cast<size_t>(std::ceil(ratio)) + 1;
+    if (stalled_) window = std::max(window, window_ + 1);
+    stalled_ = false;
+    window_ = std::min(std::max(window, MIN_PREFETCH), MAX_PREFETCH);
+  }
+
+  // Bytes downloaded ahead of the client.
+  uint64_t buffered() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t result = 0;
+    for (const auto& b : blocks_) {
+      if (!b.second) continue;
+      auto start = b.second->range_.start_;
+      auto available = std::min(b.second->size_.load(), end_ - start);
+      auto read = position_ > start ? position_ - start : 0;
+      if (available > read) result += available - read;
+    }
+    return result;
   }
 
+  std::shared_ptr<CloudProvider> provider_;
+  std::shared_ptr<BlockCache> cache_;
+  std::shared_ptr<Metrics> metrics_;
+  std::shared_ptr<Connection> connection_;
+  // Identifies the version of the file: its id, size and hash or timestamp.
+  std::string key_;
   std::mutex mutex_;
-  std::queue<char> data_;
-  std::mutex response_mutex_;
-  IHttpServer::IResponse* response_;
+  std::map<uint64_t, Block::Pointer> blocks_;
   std::shared_ptr<StreamRequest> request_;
   IItem::Pointer item_;
-  Range range_;
-  std::mutex delayed_mutex_;
-  bool delayed_ = false;
+  std::atomic<uint64_t> position_{0};
+  uint64_t next_ = 0;
+  uint64_t end_ = 0;
+  size_t window_ = MIN_PREFETCH;
+  std::chrono::steady_clock::time_point start_;
+  uint64_t consumed_ = 0;
+  double download_rate_ = 0;
+  bool stalled_ = false;
   bool done_ = false;
-  bool abort_ = false;
+  std::atomic_bool abort_{false};
 };
 
 void HttpDataCallback::receivedData(const char* data, uint32_t length) {
-  buffer_->put(data, length);
-  buffer_->resume();
+  if (!block_->append(data, length))
+    return done(Error{IHttpRequest::Failure, util::Error::BUFFER_OVERFLOW});
+  for (const auto& buffer : block_->listeners()) buffer->received(*block_);
 }
 
 void HttpDataCallback::done(EitherError<void> e) {
-  buffer_->resume();
-  buffer_->continue_download(e);
+  if (block_->state_ != Block::InProgress) return;
+  if (e.left()) {
+    block_->error_ = *e.left();
+    cache_->remove(*block_);
+    if (e.left()->code_ != IHttpRequest::Aborted) metrics_->upstream_errors_++;
+  } else {
+    metrics_->fetched(std::chrono::steady_clock::now() - block_->start_);
+  }
+  auto request = block_->finish(e.left() ? Block::Failed : Block::Done);
+  if (request) provider_->thread_pool()->schedule([request] {});
+  for (const auto& buffer : block_->listeners()) {
+    buffer->block_done(block_, e);
+    buffer->received(*block_);
+  }
 }
 
 class HttpData : public IHttpServer::IResponse::ICallback {
@@ -203,6 +577,7 @@ class HttpData : public IHttpServer::IResponse::ICallback {
 
   ~HttpData() override {
     buffer_->done(Error{IHttpRequest::Aborted, util::Error::ABORTED});
+    buffer_->release();
     provider_->removeStreamRequest(request_);
   }
 
@@ -224,19 +599,13 @@ class HttpData : public IHttpServer::IResponse::ICallback {
             buffer_->done(Error{IHttpRequest::Bad, util::Error::INVALID_RANGE});
           } else {
             status_ = Success;
-            buffer_->item_ = e.right();
-            buffer_->range_ = range;
-            cache->put(file, e.right());
-            r->make_subrequest(
-                &CloudProvider::downloadFileRangeAsync, e.right(),
-                Range{range.start_,
-                      std::min<uint64_t>(range.size_, CHUNK_SIZE)},
-                util::make_unique<HttpDataCallback>(buffer_));
+            cache->put(buffer_->key_, e.right());
+            buffer_->start(e.right(), range);
           }
         }
         buffer_->resume();
       };
-      auto cached_item = cache->get(file);
+      auto cached_item = cache->get(buffer_->key_);
       if (cached_item == nullptr)
         r->make_subrequest(&CloudProvider::getItemDataAsync, file,
                            item_received);
@@ -269,8 +638,83 @@ class HttpData : public IHttpServer::IResponse::ICallback {
   std::shared_ptr<ICloudProvider::DownloadFileRequest> request_;
 };
 
-HttpServerCallback::HttpServerCallback(std::shared_ptr<CloudProvider> p)
-    : item_cache_(util::make_unique<Cache>(CACHE_SIZE)),
+// Sends ranges of a file as parts of a multipart/byteranges body, streaming
+// them one after another.
+class MultipartData : public IHttpServer::IResponse::ICallback {
+ public:
+  using Stream = std::function<ICallback::Pointer(Range)>;
+
+  struct Part {
+    std::string header_;
+    Range range_;
+  };
+
+  MultipartData(std::vector<Part> parts, std::string trailer, Stream stream)
+      : parts_(std::move(parts)),
+        trailer_(std::move(trailer)),
+        stream_(std::move(stream)) {}
+
+  int putData(char* buf, size_t max) override {
+    while (current_ < parts_.size()) {
+      const auto& part = parts_[current_];
+      if (offset_ < part.header_.size()) return copy(part.header_, buf, max);
+      if (sent_ < part.range_.size_) {
+        if (!data_) data_ = stream_(part.range_);
+        auto r = data_->putData(
+            buf, std::min<uint64_t>(max, part.range_.size_ - sent_));
+        if (r > 0) sent_ += r;
+        return r;
+      }
+      data_ = nullptr;
+      current_++;
+      offset_ = 0;
+      sent_ = 0;
+    }
+    if (offset_ < trailer_.size()) return copy(trailer_, buf, max);
+    return End;
+  }
+
+ private:
+  int copy(const std::string& data, char* buf, size_t max) {
+    auto cnt = std::min(max, data.size() - offset_);
+    memcpy(buf, data.data() + offset_, cnt);
+    offset_ += cnt;
+    return static_cast<int>(cnt);
+  }
+
+  std::vector<Part> parts_;
+  std::string trailer_;
+  Stream stream_;
+  ICallback::Pointer data_;
+  size_t current_ = 0;
+  size_t offset_ = 0;
+  uint64_t sent_ = 0;
+};
+
+// Body of responses to HEAD requests, never sent.
+class EmptyData : public IHttpServer::IResponse::ICallback {
+ public:
+  int putData(char*, size_t) override { return End; }
+};
+
+// Content hash or modification time from the daemon url, empty if the
+// provider knows neither.
+std::string version(const Json::Value& json) {
+  return json.isMember("hash") ? json["hash"].asString()
+                               : json["timestamp"].asString();
+}
+
+std::string file_key(const Json::Value& json) {
+  return json["id"].asString() + ":" + json["size"].asString() + ":" +
+         version(json);
+}
+
+HttpServerCallback::HttpServerCallback(std::shared_ptr<CloudProvider> p,
+                                       const FileServer::Options& options)
+    : item_cache_(util::make_unique<Cache>(options.item_cache_size_, nullptr,
+                                           CACHE_SHARDS)),
+      block_cache_(std::make_shared<BlockCache>(options.block_cache_size_)),
+      metrics_(std::make_shared<Metrics>()),
       provider_(std::move(p)) {}
 
 IHttpServer::IResponse::Pointer HttpServerCallback::handle(
@@ -279,6 +723,7 @@ IHttpServer::IResponse::Pointer HttpServerCallback::handle(
     auto url_fragment =
         std::string(request.url())
             .substr(std::string(request.url()).find_last_of('/') + 1);
+    if (url_fragment == "metrics") return metrics(request);
     std::replace(url_fragment.begin(), url_fragment.end(), '-', '/');
     auto json = util::json::from_string(util::from_base64(url_fragment));
     if (json["state"] != provider_->auth()->state())
@@ -287,39 +732,89 @@ IHttpServer::IResponse::Pointer HttpServerCallback::handle(
     auto id = json["id"].asString();
     auto filename = json["name"].asString();
     auto size = json["size"].asUInt64();
+    auto key = file_key(json);
     auto extension = filename.substr(filename.find_last_of('.') + 1);
+    auto etag = FileServer::entity_tag(json);
     std::unordered_map<std::string, std::string> headers = {
         {"Content-Type", util::to_mime_type(extension)},
         {"Accept-Ranges", "bytes"},
         {"Content-Disposition", "inline; filename=\"" + filename + "\""},
         {"Access-Control-Allow-Origin", "*"},
         {"Access-Control-Allow-Headers", "*"}};
+    if (!etag.empty()) headers["ETag"] = etag;
     if (request.method() == "OPTIONS")
       return util::response_from_string(request, IHttpRequest::Ok, headers, "");
-    Range range = {0, size};
+    const char* if_none_match = request.header("If-None-Match");
+    if (if_none_match && FileServer::matches_tag(if_none_match, etag))
+      return util::response_from_string(request, IHttpRequest::NotModified,
+                                        headers, "");
+    std::vector<Range> ranges;
+    const char* range_str = request.header("Range");
+    const char* if_range = request.header("If-Range");
+    if (range_str && (!if_range || (!etag.empty() && if_range == etag)) &&
+        FileServer::parse_ranges(range_str, size, ranges)) {
+      if (ranges.empty())
+        return util::response_from_string(
+            request, IHttpRequest::RangeInvalid,
+            {{"Content-Range", "bytes */" + std::to_string(size)}},
+            util::Error::INVALID_RANGE);
+    } else {
+      ranges.clear();
+    }
+    auto connection = std::make_shared<Connection>();
     int code = IHttpRequest::Ok;
-    if (const char* range_str = request.header("Range")) {
-      range = util::parse_range(range_str);
-      if (range.size_ == Range::Full) range.size_ = size - range.start_;
-      if (range.start_ + range.size_ > size)
-        return util::response_from_string(request, IHttpRequest::RangeInvalid,
-                                          {}, util::Error::INVALID_RANGE);
-      std::stringstream stream;
-      stream << "bytes " << range.start_ << "-"
-             << range.start_ + range.size_ - 1 << "/" << size;
-      headers["Content-Range"] = stream.str();
+    IHttpServer::IResponse::Pointer response;
+    if (ranges.size() > 1) {
       code = IHttpRequest::Partial;
+      std::vector<MultipartData::Part> parts;
+      uint64_t length = 0;
+      for (auto range : ranges) {
+        std::stringstream stream;
+        stream << "\r\n--" << BOUNDARY << "\r\n"
+               << "Content-Type: " << headers["Content-Type"] << "\r\n"
+               << "Content-Range: bytes " << range.start_ << "-"
+               << range.start_ + range.size_ - 1 << "/" << size
+               << "\r\n\r\n";
+        parts.push_back({stream.str(), range});
+        length += parts.back().header_.size() + range.size_;
+      }
+      auto trailer = std::string("\r\n--") + BOUNDARY + "--\r\n";
+      length += trailer.size();
+      headers["Content-Type"] =
+          std::string("multipart/byteranges; boundary=") + BOUNDARY;
+      if (request.method() == "HEAD")
+        return request.response(code, headers, length,
+                                util::make_unique<EmptyData>());
+      response = request.response(
+          code, headers, length,
+          util::make_unique<MultipartData>(
+              std::move(parts), trailer, [=](Range range) {
+                return stream(id, key, range, connection);
+              }));
+    } else {
+      Range range = {0, size};
+      if (!ranges.empty()) {
+        range = ranges.front();
+        std::stringstream stream;
+        stream << "bytes " << range.start_ << "-"
+               << range.start_ + range.size_ - 1 << "/" << size;
+        headers["Content-Range"] = stream.str();
+        code = IHttpRequest::Partial;
+      }
+      if (request.method() == "HEAD")
+        return request.response(code, headers, range.size_,
+                                util::make_unique<EmptyData>());
+      auto local_path = provider_->localFilePath(id);
+      if (!local_path.empty()) {
+        if (auto response = request.file_response(code, headers, local_path,
+                                                  range.start_, range.size_))
+          return response;
+      }
+      response = request.response(code, headers, range.size_,
+                                  stream(id, key, range, connection));
     }
-    auto buffer = std::make_shared<Buffer>();
-    auto data =
-        util::make_unique<HttpData>(buffer, provider_, id, range, item_cache_);
-    auto response =
-        request.response(code, headers, range.size_, std::move(data));
-    buffer->response_ = response.get();
-    response->completed([buffer]() {
-      std::unique_lock<std::mutex> lock(buffer->response_mutex_);
-      buffer->response_ = nullptr;
-    });
+    connection->set(response.get());
+    response->completed([connection]() { connection->set(nullptr); });
     return response;
   } catch (const Json::Exception& e) {
     util::log("[HTTP SERVER] invalid request", request.url(), e.what());
@@ -328,11 +823,140 @@ IHttpServer::IResponse::Pointer HttpServerCallback::handle(
   }
 }
 
+IHttpServer::IResponse::ICallback::Pointer HttpServerCallback::stream(
+    const std::string& id, const std::string& key, Range range,
+    const std::shared_ptr<Connection>& connection) {
+  auto buffer = std::make_shared<Buffer>(provider_, block_cache_, metrics_,
+                                         connection, key);
+  metrics_->add(buffer);
+  return util::make_unique<HttpData>(buffer, provider_, id, range,
+                                     item_cache_);
+}
+
+IHttpServer::IResponse::Pointer HttpServerCallback::metrics(
+    const IHttpServer::IRequest& request) {
+  auto label = "{provider=\"" + provider_->name() + "\"}";
+  std::stringstream stream;
+  auto metric = [&](const std::string& name, const std::string& type,
+                    const std::string& help, uint64_t value) {
+    auto full_name = "cloudstorage_file_server_" + name;
+    stream << "# HELP " << full_name << " " << help << "\n"
+           << "# TYPE " << full_name << " " << type << "\n"
+           << full_name << label << " " << value << "\n";
+  };
+  auto streams = metrics_->streams();
+  uint64_t buffered = 0;
+  for (const auto& s : streams) buffered += s->buffered();
+  metric("streams", "gauge", "Streams being served.", streams.size());
+  metric("served_bytes_total", "counter", "Bytes sent to clients.",
+         metrics_->bytes_served_);
+  metric("buffered_bytes", "gauge",
+         "Bytes downloaded ahead of the position of each stream.", buffered);
+  metric("stalls_total", "counter",
+         "Times a client waited for data which wasn't downloaded yet.",
+         metrics_->stalls_);
+  metric("upstream_errors_total", "counter",
+         "Failed downloads from the provider.", metrics_->upstream_errors_);
+  metric("block_cache_bytes", "gauge", "Bytes held by the block cache.",
+         block_cache_->size());
+  metric("block_cache_hits_total", "counter",
+         "Blocks found in the cache or already being downloaded.",
+         block_cache_->hits());
+  metric("block_cache_misses_total", "counter",
+         "Blocks which had to be downloaded.", block_cache_->misses());
+  metric("item_cache_hits_total", "counter", "Items found in the cache.",
+         item_cache_->hits());
+  metric("item_cache_misses_total", "counter",
+         "Items which had to be fetched from the provider.",
+         item_cache_->misses());
+  {
+    auto name = std::string("cloudstorage_file_server_block_fetch_seconds");
+    auto provider = "provider=\"" + provider_->name() + "\"";
+    std::lock_guard<std::mutex> lock(metrics_->mutex_);
+    stream << "# HELP " << name << " Time taken to download a block.\n"
+           << "# TYPE " << name << " histogram\n";
+    for (size_t i = 0; i < Metrics::FetchBucketCount; i++)
+      stream << name << "_bucket{" << provider << ",le=\""
+             << Metrics::FetchBuckets[i] << "\"} "
+             << metrics_->fetch_buckets_[i] << "\n";
+    stream << name << "_bucket{" << provider << ",le=\"+Inf\"} "
+           << metrics_->fetch_count_ << "\n"
+           << name << "_sum" << label << " " << metrics_->fetch_sum_ << "\n"
+           << name << "_count" << label << " " << metrics_->fetch_count_
+           << "\n";
+  }
+  return util::response_from_string(
+      request, IHttpRequest::Ok,
+      {{"Content-Type", "text/plain; version=0.0.4"}}, stream.str());
+}
+
 }  // namespace
 
+bool FileServer::parse_ranges(const std::string& header, uint64_t size,
+                              std::vector<Range>& result) {
+  auto str = util::remove_whitespace(header);
+  const std::string prefix = "bytes=";
+  if (str.compare(0, prefix.size(), prefix) != 0) return false;
+  auto is_number = [](const std::string& str) {
+    return std::all_of(str.begin(), str.end(),
+                       [](char c) { return c >= '0' && c <= '9'; });
+  };
+  try {
+    std::stringstream stream(str.substr(prefix.size()));
+    std::string spec;
+    while (std::getline(stream, spec, ',')) {
+      auto dash = spec.find('-');
+      if (dash == std::string::npos) return false;
+      auto first = spec.substr(0, dash);
+      auto last = spec.substr(dash + 1);
+      if (!is_number(first) || !is_number(last) || (first + last).empty())
+        return false;
+      if (first.empty()) {
+        auto length = std::min<uint64_t>(std::stoull(last), size);
+        if (length > 0) result.push_back({size - length, length});
+        continue;
+      }
+      auto start = std::stoull(first);
+      auto end = last.empty() ? size : std::stoull(last) + 1;
+      if (!last.empty() && end <= start) return false;
+      if (start < size)
+        result.push_back({start, std::min<uint64_t>(end, size) - start});
+    }
+  } catch (const std::logic_error&) {
+    return false;
+  }
+  return result.size() <= MAX_RANGES;
+}
+
+std::string FileServer::entity_tag(const Json::Value& json) {
+  if (version(json).empty()) return "";
+  uint64_t hash = 14695981039346656037ULL;
+  for (char c : file_key(json)) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ULL;
+  }
+  std::stringstream stream;
+  stream << "\"" << std::hex << hash << "\"";
+  return stream.str();
+}
+
+bool FileServer::matches_tag(const std::string& header,
+                             const std::string& etag) {
+  if (etag.empty()) return false;
+  std::stringstream stream(util::remove_whitespace(header));
+  std::string tag;
+  while (std::getline(stream, tag, ',')) {
+    if (tag.compare(0, 2, "W/") == 0) tag = tag.substr(2);
+    if (tag == "*" || tag == etag) return true;
+  }
+  return false;
+}
+
 IHttpServer::Pointer FileServer::create(std::shared_ptr<CloudProvider> p,
-                                        const std::string& session) {
-  return p->http_server()->create(util::make_unique<HttpServerCallback>(p),
-                                  session, IHttpServer::Type::FileProvider);
+                                        const std::string& session,
+                                        const Options& options) {
+  return p->http_server()->create(
+      util::make_unique<HttpServerCallback>(p, options), session,
+      IHttpServer::Type::FileProvider);
 }
 }  // namespace cloudstorage
@@ -29,8 +29,48 @@ namespace cloudstorage {
 
 class FileServer : public IHttpServer {
  public:
+  struct Options {
+    static constexpr size_t DefaultItemCacheSize = 128;
+    static constexpr size_t DefaultBlockCacheSize = 256 * 1024 * 1024;
+
+    /**
+     * Number of items whose metadata is kept between requests.
+     */
+    size_t item_cache_size_ = DefaultItemCacheSize;
+
+    /**
+     * Bytes of file data kept for reuse by other requests.
+     */
+    size_t block_cache_size_ = DefaultBlockCacheSize;
+  };
+
   static IHttpServer::Pointer create(std::shared_ptr<CloudProvider> p,
-                                     const std::string& session);
+                                     const std::string& session,
+                                     const Options&);
+
+  /**
+   * Parses "bytes=" range header, with "-n" meaning the last n bytes; ranges
+   * reaching past the end of the file are cut and the ones starting past it
+   * are skipped.
+   *
+   * @return false if the header should be ignored
+   */
+  static bool parse_ranges(const std::string& header, uint64_t size,
+                           std::vector<Range>&);
+
+  /**
+   * Builds entity tag of the file described by the daemon url's json.
+   *
+   * @return empty string if the url carries neither content hash nor
+   * modification time, as the tag couldn't tell two versions of the file
+   * apart then
+   */
+  static std::string entity_tag(const Json::Value& json);
+
+  /**
+   * @return whether If-None-Match header, a list of tags, matches etag
+   */
+  static bool matches_tag(const std::string& header, const std::string& etag);
 
  private:
   FileServer() = default;
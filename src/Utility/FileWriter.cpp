@@ -0,0 +1,186 @@
+/*****************************************************************************
+ * FileWriter.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "FileWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cloudstorage {
+
+namespace {
+
+const size_t DIRECT_IO_ALIGNMENT = 4096;
+const size_t DIRECT_IO_BUFFER_SIZE = 1024 * 1024;
+
+#ifndef _WIN32
+bool write_all(int fd, const char* data, size_t length, uint64_t offset) {
+  while (length > 0) {
+    auto written = pwrite(fd, data, length, static_cast<off_t>(offset));
+    if (written == -1 && errno == EINTR) continue;
+    if (written <= 0) return false;
+    data += written;
+    length -= static_cast<size_t>(written);
+    offset += static_cast<uint64_t>(written);
+  }
+  return true;
+}
+#endif
+
+}  // namespace
+
+FileWriter::FileWriter(const std::string& path, bool truncate, bool direct)
+    :
+#ifndef _WIN32
+      fd_(-1),
+#endif
+      direct_(false),
+      resume_offset_(0),
+      buffer_(nullptr, free),
+      buffered_(0),
+      buffer_offset_(0) {
+#ifdef _WIN32
+  (void)direct;
+  if (truncate) {
+    file_.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  } else {
+    file_.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file_.is_open())
+      file_.open(path, std::ios::out | std::ios::binary);
+    file_.seekp(0, std::ios::end);
+    resume_offset_ = static_cast<uint64_t>(file_.tellp());
+  }
+#else
+  int flags = O_WRONLY | O_CREAT | (truncate ? O_TRUNC : 0);
+#ifdef O_DIRECT
+  void* buffer;
+  if (direct && posix_memalign(&buffer, DIRECT_IO_ALIGNMENT,
+                               DIRECT_IO_BUFFER_SIZE) == 0) {
+    buffer_.reset(static_cast<char*>(buffer));
+    // some filesystems, e.g. tmpfs, don't support direct io
+    fd_ = open(path.c_str(), flags | O_DIRECT, 0644);
+    direct_ = fd_ != -1;
+  }
+#else
+  (void)direct;
+#endif
+  if (fd_ == -1) fd_ = open(path.c_str(), flags, 0644);
+  struct stat st;
+  if (fd_ != -1 && !truncate && fstat(fd_, &st) == 0) {
+    resume_offset_ = static_cast<uint64_t>(st.st_size);
+    if (direct_) resume_offset_ -= resume_offset_ % DIRECT_IO_ALIGNMENT;
+  }
+#endif
+  buffer_offset_ = resume_offset_;
+}
+
+FileWriter::~FileWriter() {
+#ifndef _WIN32
+  if (fd_ != -1) ::close(fd_);
+#endif
+}
+
+bool FileWriter::good() const {
+#ifdef _WIN32
+  return file_.is_open();
+#else
+  return fd_ != -1;
+#endif
+}
+
+bool FileWriter::direct() const { return direct_; }
+
+uint64_t FileWriter::resume_offset() const { return resume_offset_; }
+
+void FileWriter::preallocate(uint64_t size) {
+#ifdef __linux__
+  // keep the size, so that it tells how much was written if we're stopped
+  if (fd_ != -1)
+    fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+#else
+  (void)size;
+#endif
+}
+
+bool FileWriter::write(const char* data, size_t length, uint64_t offset) {
+#ifdef _WIN32
+  file_.seekp(static_cast<std::streamoff>(offset));
+  file_.write(data, static_cast<std::streamsize>(length));
+  return !file_.fail();
+#else
+  if (fd_ == -1) return false;
+  if (!direct_) return write_all(fd_, data, length, offset);
+  if (offset != buffer_offset_ + buffered_) return false;
+  while (length > 0) {
+    auto count = std::min(length, DIRECT_IO_BUFFER_SIZE - buffered_);
+    memcpy(buffer_.get() + buffered_, data, count);
+    buffered_ += count;
+    data += count;
+    length -= count;
+    if (buffered_ == DIRECT_IO_BUFFER_SIZE && !flush()) return false;
+  }
+  return true;
+#endif
+}
+
+bool FileWriter::close() {
+#ifdef _WIN32
+  file_.close();
+  return !file_.fail();
+#else
+  if (fd_ == -1) return false;
+  bool success = true;
+#ifdef O_DIRECT
+  if (direct_ && buffered_ > 0) {
+    // the tail isn't a whole block, it has to go through the page cache
+    int flags = fcntl(fd_, F_GETFL);
+    success = flags != -1 && fcntl(fd_, F_SETFL, flags & ~O_DIRECT) != -1 &&
+              flush();
+  }
+#endif
+  success = ::close(fd_) == 0 && success;
+  fd_ = -1;
+  return success;
+#endif
+}
+
+bool FileWriter::flush() {
+#ifdef _WIN32
+  return true;
+#else
+  if (!write_all(fd_, buffer_.get(), buffered_, buffer_offset_)) return false;
+  buffer_offset_ += buffered_;
+  buffered_ = 0;
+  return true;
+#endif
+}
+
+}  // namespace cloudstorage
@@ -0,0 +1,76 @@
+/*****************************************************************************
+ * FileWriter.h
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef FILEWRITER_H
+#define FILEWRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace cloudstorage {
+
+/**
+ * Writes downloaded data to a file at given offsets. On posix systems data
+ * goes straight to the descriptor with pwrite and space for the whole file is
+ * reserved upfront where the filesystem supports it. With direct io, writes
+ * bypass the page cache; they are gathered in an aligned buffer, so they
+ * have to come in order.
+ */
+class FileWriter {
+ public:
+  FileWriter(const std::string& path, bool truncate, bool direct);
+  ~FileWriter();
+
+  bool good() const;
+  bool direct() const;
+
+  /**
+   * Offset at which writing should start to continue the existing file; it
+   * is rounded down to the block size with direct io.
+   */
+  uint64_t resume_offset() const;
+
+  void preallocate(uint64_t size);
+  bool write(const char* data, size_t length, uint64_t offset);
+  bool close();
+
+ private:
+  bool flush();
+
+#ifdef _WIN32
+  std::fstream file_;
+#else
+  int fd_;
+#endif
+  bool direct_;
+  uint64_t resume_offset_;
+  std::unique_ptr<char, void (*)(void*)> buffer_;
+  size_t buffered_;
+  uint64_t buffer_offset_;
+};
+
+}  // namespace cloudstorage
+
+#endif  // FILEWRITER_H
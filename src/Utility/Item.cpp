@@ -65,7 +65,8 @@ Item::Item(std::string filename, std::string id, size_t size,
       timestamp_(timestamp),
       thumbnail_url_(),
       type_(type),
-      is_hidden_(false) {
+      is_hidden_(false),
+      hash_type_(HashType::None) {
   if (type_ == IItem::FileType::Unknown)
     type_ = fromExtension(Item::extension());
 }
@@ -105,6 +106,10 @@ std::string Item::toString() const {
   if (is_hidden()) json["hidden"] = is_hidden();
   if (!thumbnail_url().empty()) json["thumbnail_url"] = thumbnail_url();
   if (!url().empty()) json["url"] = url();
+  if (hash_type() != HashType::None) {
+    json["hash_type"] = static_cast<int>(hash_type());
+    json["hash"] = hash();
+  }
   return util::json::to_string(json);
 }
 
@@ -122,6 +127,8 @@ IItem::Pointer IItem::fromString(const std::string& str) {
   std::vector<std::string> parents;
   for (auto&& p : json["parents"]) parents.push_back(p.asString());
   item->set_parents(parents);
+  item->set_hash(static_cast<IItem::HashType>(json["hash_type"].asInt()),
+                 json["hash"].asString());
   return item;
 }
 
@@ -153,6 +160,15 @@ IItem::FileType Item::type() const { return type_; }
 
 void Item::set_type(FileType t) { type_ = t; }
 
+std::string Item::hash() const { return hash_; }
+
+IItem::HashType Item::hash_type() const { return hash_type_; }
+
+void Item::set_hash(HashType type, std::string hash) {
+  hash_type_ = type;
+  hash_ = std::move(hash);
+}
+
 const std::vector<std::string>& Item::parents() const { return parents_; }
 
 void Item::set_parents(const std::vector<std::string>& parents) {
@@ -62,6 +62,10 @@ class CLOUDSTORAGE_API Item : public IItem {
   FileType type() const override;
   void set_type(FileType);
 
+  std::string hash() const override;
+  HashType hash_type() const override;
+  void set_hash(HashType, std::string);
+
   const std::vector<std::string>& parents() const;
   void set_parents(const std::vector<std::string>&);
 
@@ -83,6 +87,8 @@ class CLOUDSTORAGE_API Item : public IItem {
   bool is_hidden_;
   std::string mime_type_;
   std::vector<std::string> parents_;
+  HashType hash_type_;
+  std::string hash_;
 };
 
 }  // namespace cloudstorage
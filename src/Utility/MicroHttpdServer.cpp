@@ -26,11 +26,16 @@
 #include "MicroHttpdServer.h"
 
 #include <microhttpd.h>
+#include <vector>
 #include "Utility.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace cloudstorage {
 
-const int CHUNK_SIZE = 1024;
 const int AUTHORIZATION_PORT = 12345;
 const int FILE_PROVIDER_PORT = 12346;
 
@@ -49,8 +54,8 @@ int http_request_callback(void* cls, MHD_Connection* c, const char* url,
   if (auto d = static_cast<ConnectionData*>(*con_cls)) {
     int ret = MHD_YES;
     if (*upload_data_size == 0) {
-      auto response =
-          server->callback()->handle(MicroHttpdServer::Request(c, url, method));
+      auto response = server->callback()->handle(MicroHttpdServer::Request(
+          c, url, method, server->options().block_size_));
       auto p = static_cast<MicroHttpdServer::Response*>(response.get());
       ret = MHD_queue_response(c, p->code(), p->response());
       d->response_ = std::move(response);
@@ -75,12 +80,16 @@ void http_request_completed(void*, MHD_Connection*, void** con_cls,
 }  // namespace
 
 IHttpServerFactory::Pointer IHttpServerFactory::create() {
-  return util::make_unique<MicroHttpdServerFactory>();
+  return create(Options{});
+}
+
+IHttpServerFactory::Pointer IHttpServerFactory::create(const Options& options) {
+  return util::make_unique<MicroHttpdServerFactory>(options);
 }
 
 MicroHttpdServer::Response::Response(MHD_Connection* connection, int code,
                                      const IResponse::Headers& headers,
-                                     int64_t size,
+                                     int64_t size, size_t block_size,
                                      IResponse::ICallback::Pointer callback)
     : data_(std::make_shared<SharedData>()),
       connection_(connection),
@@ -116,12 +125,23 @@ MicroHttpdServer::Response::Response(MHD_Connection* connection, int code,
   auto data = util::make_unique<DataType>(
       DataType{data_, connection, std::move(callback)});
   response_ = MHD_create_response_from_callback(
-      size == UnknownSize ? MHD_SIZE_UNKNOWN : size, CHUNK_SIZE, data_provider,
+      size == UnknownSize ? MHD_SIZE_UNKNOWN : size, block_size, data_provider,
       data.release(), release_data);
   for (const auto& it : headers)
     MHD_add_response_header(response_, it.first.c_str(), it.second.c_str());
 }
 
+MicroHttpdServer::Response::Response(MHD_Connection* connection, int code,
+                                     const IResponse::Headers& headers,
+                                     MHD_Response* response)
+    : data_(std::make_shared<SharedData>()),
+      connection_(connection),
+      response_(response),
+      code_(code) {
+  for (const auto& it : headers)
+    MHD_add_response_header(response_, it.first.c_str(), it.second.c_str());
+}
+
 MicroHttpdServer::Response::~Response() {
   if (response_) MHD_destroy_response(response_);
 }
@@ -135,8 +155,8 @@ void MicroHttpdServer::Response::resume() {
 }
 
 MicroHttpdServer::Request::Request(MHD_Connection* c, const char* url,
-                                   const char* method)
-    : connection_(c), url_(url), method_(method) {}
+                                   const char* method, size_t block_size)
+    : connection_(c), url_(url), method_(method), block_size_(block_size) {}
 
 const char* MicroHttpdServer::Request::get(const std::string& name) const {
   return MHD_lookup_connection_value(connection_, MHD_GET_ARGUMENT_KIND,
@@ -152,12 +172,34 @@ std::string MicroHttpdServer::Request::url() const { return url_; }
 
 std::string MicroHttpdServer::Request::method() const { return method_; }
 
-MicroHttpdServer::MicroHttpdServer(IHttpServer::ICallback::Pointer cb, int port)
-    : http_server_(MHD_start_daemon(
-          MHD_USE_AUTO_INTERNAL_THREAD | MHD_USE_SUSPEND_RESUME, port, nullptr,
-          nullptr, http_request_callback, this, MHD_OPTION_NOTIFY_COMPLETED,
-          http_request_completed, this, MHD_OPTION_END)),
-      callback_(std::move(cb)) {}
+MicroHttpdServer::MicroHttpdServer(IHttpServer::ICallback::Pointer cb, int port,
+                                   const IHttpServerFactory::Options& options)
+    : options_(options), http_server_(), callback_(std::move(cb)) {
+  unsigned int flags = MHD_USE_SUSPEND_RESUME;
+  if (MHD_is_feature_supported(MHD_FEATURE_EPOLL) == MHD_YES)
+    flags |= MHD_USE_EPOLL_INTERNAL_THREAD;
+  else
+    flags |= MHD_USE_AUTO_INTERNAL_THREAD;
+  std::vector<MHD_OptionItem> items = {
+      {MHD_OPTION_NOTIFY_COMPLETED,
+       reinterpret_cast<intptr_t>(http_request_completed), this}};
+  if (options.thread_count_ > 1)
+    items.push_back({MHD_OPTION_THREAD_POOL_SIZE,
+                     static_cast<intptr_t>(options.thread_count_), nullptr});
+  if (options.connection_limit_ > 0)
+    items.push_back({MHD_OPTION_CONNECTION_LIMIT,
+                     static_cast<intptr_t>(options.connection_limit_),
+                     nullptr});
+  if (options.per_ip_connection_limit_ > 0)
+    items.push_back({MHD_OPTION_PER_IP_CONNECTION_LIMIT,
+                     static_cast<intptr_t>(options.per_ip_connection_limit_),
+                     nullptr});
+  items.push_back({MHD_OPTION_END, 0, nullptr});
+  http_server_ = MHD_start_daemon(flags, port, nullptr, nullptr,
+                                  http_request_callback, this,
+                                  MHD_OPTION_ARRAY, items.data(),
+                                  MHD_OPTION_END);
+}
 
 MicroHttpdServer::~MicroHttpdServer() {
   if (http_server_) MHD_stop_daemon(http_server_);
@@ -167,10 +209,28 @@ MicroHttpdServer::IResponse::Pointer MicroHttpdServer::Request::response(
     int code, const IResponse::Headers& headers, int64_t size,
     IResponse::ICallback::Pointer cb) const {
   return util::make_unique<Response>(connection_, code, headers, size,
-                                     std::move(cb));
+                                     block_size_, std::move(cb));
+}
+
+MicroHttpdServer::IResponse::Pointer MicroHttpdServer::Request::file_response(
+    int code, const IResponse::Headers& headers, const std::string& path,
+    uint64_t offset, uint64_t size) const {
+#ifdef _WIN32
+  return nullptr;
+#else
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) return nullptr;
+  auto response = MHD_create_response_from_fd_at_offset64(size, fd, offset);
+  if (!response) {
+    close(fd);
+    return nullptr;
+  }
+  return util::make_unique<Response>(connection_, code, headers, response);
+#endif
 }
 
-MicroHttpdServerFactory::MicroHttpdServerFactory() {
+MicroHttpdServerFactory::MicroHttpdServerFactory(const Options& options)
+    : options_(options) {
   MHD_set_panic_func(
       [](void*, const char* file, unsigned int line, const char* reason) {
         util::log(file, line, reason);
@@ -181,7 +241,12 @@ MicroHttpdServerFactory::MicroHttpdServerFactory() {
 
 IHttpServer::Pointer MicroHttpdServerFactory::create(
     IHttpServer::ICallback::Pointer cb, uint16_t port) {
-  auto result = util::make_unique<MicroHttpdServer>(cb, port);
+  return create(cb, port, options_);
+}
+
+IHttpServer::Pointer MicroHttpdServerFactory::create(
+    IHttpServer::ICallback::Pointer cb, uint16_t port, const Options& options) {
+  auto result = util::make_unique<MicroHttpdServer>(cb, port, options);
   if (result->valid())
     return result;
   else
@@ -191,9 +256,13 @@ IHttpServer::Pointer MicroHttpdServerFactory::create(
 IHttpServer::Pointer MicroHttpdServerFactory::create(
     IHttpServer::ICallback::Pointer cb, const std::string&,
     IHttpServer::Type type) {
-  return create(cb, type == IHttpServer::Type::Authorization
-                        ? AUTHORIZATION_PORT
-                        : FILE_PROVIDER_PORT);
+  if (type == IHttpServer::Type::Authorization) {
+    // Authorization callbacks expect their requests one at a time.
+    auto options = options_;
+    options.thread_count_ = 1;
+    return create(cb, AUTHORIZATION_PORT, options);
+  }
+  return create(cb, FILE_PROVIDER_PORT);
 }
 
 }  // namespace cloudstorage
@@ -204,6 +273,10 @@ IHttpServer::Pointer MicroHttpdServerFactory::create(
 
 namespace cloudstorage {
 IHttpServerFactory::Pointer IHttpServerFactory::create() { return nullptr; }
+
+IHttpServerFactory::Pointer IHttpServerFactory::create(const Options&) {
+  return nullptr;
+}
 }  // namespace cloudstorage
 
 #endif  // WITH_MICROHTTPD
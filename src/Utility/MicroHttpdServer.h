@@ -38,13 +38,16 @@ namespace cloudstorage {
 
 class MicroHttpdServer : public IHttpServer {
  public:
-  MicroHttpdServer(IHttpServer::ICallback::Pointer cb, int port);
+  MicroHttpdServer(IHttpServer::ICallback::Pointer cb, int port,
+                   const IHttpServerFactory::Options&);
   ~MicroHttpdServer() override;
 
   class Response : public IResponse {
    public:
     Response(MHD_Connection* connection, int code, const IResponse::Headers&,
-             int64_t size, IResponse::ICallback::Pointer);
+             int64_t size, size_t block_size, IResponse::ICallback::Pointer);
+    Response(MHD_Connection* connection, int code, const IResponse::Headers&,
+             MHD_Response*);
     ~Response() override;
 
     MHD_Response* response() const { return response_; }
@@ -68,7 +71,8 @@ class MicroHttpdServer : public IHttpServer {
 
   class Request : public IRequest {
    public:
-    Request(MHD_Connection*, const char* url, const char* method);
+    Request(MHD_Connection*, const char* url, const char* method,
+            size_t block_size);
 
     MHD_Connection* connection() const { return connection_; }
 
@@ -80,29 +84,41 @@ class MicroHttpdServer : public IHttpServer {
     IResponse::Pointer response(int code, const IResponse::Headers&,
                                 int64_t size,
                                 IResponse::ICallback::Pointer) const override;
+    IResponse::Pointer file_response(int code, const IResponse::Headers&,
+                                     const std::string& path, uint64_t offset,
+                                     uint64_t size) const override;
 
    private:
     MHD_Connection* connection_;
     std::string url_;
     std::string method_;
+    size_t block_size_;
   };
 
   ICallback::Pointer callback() const override { return callback_; }
 
   bool valid() const { return http_server_; }
 
+  const IHttpServerFactory::Options& options() const { return options_; }
+
  private:
+  IHttpServerFactory::Options options_;
   MHD_Daemon* http_server_;
   ICallback::Pointer callback_;
 };
 
 class MicroHttpdServerFactory : public IHttpServerFactory {
  public:
-  MicroHttpdServerFactory();
+  MicroHttpdServerFactory(const Options& = {});
   IHttpServer::Pointer create(IHttpServer::ICallback::Pointer, uint16_t port);
+  IHttpServer::Pointer create(IHttpServer::ICallback::Pointer, uint16_t port,
+                              const Options&);
   IHttpServer::Pointer create(IHttpServer::ICallback::Pointer,
                               const std::string& session_id,
                               IHttpServer::Type) override;
+
+ private:
+  Options options_;
 };
 
 }  // namespace cloudstorage
@@ -0,0 +1,252 @@
+/*****************************************************************************
+ * SearchIndex.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "SearchIndex.h"
+
+#include <json/json.h>
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+#include "Utility/Utility.h"
+
+namespace cloudstorage {
+
+namespace {
+
+const int MAX_PATH_DEPTH = 64;
+
+std::unordered_set<uint32_t> trigrams(const std::string& str) {
+  std::unordered_set<uint32_t> result;
+  for (size_t i = 0; i + 3 <= str.length(); i++)
+    result.insert(static_cast<uint32_t>(static_cast<uint8_t>(str[i])) << 16 |
+                  static_cast<uint32_t>(static_cast<uint8_t>(str[i + 1]))
+                      << 8 |
+                  static_cast<uint32_t>(static_cast<uint8_t>(str[i + 2])));
+  return result;
+}
+
+int rank(const std::string& name, const std::string& query, size_t position) {
+  if (name.length() == query.length()) return 0;
+  if (position == 0) return 1;
+  if (!std::isalnum(static_cast<unsigned char>(name[position - 1]))) return 2;
+  return 3;
+}
+
+}  // namespace
+
+constexpr size_t SearchIndex::DEFAULT_LIMIT;
+
+void SearchIndex::add(const std::string& parent, const IItem::Pointer& item) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  insert(parent, item);
+}
+
+void SearchIndex::update(const std::string& parent,
+                         const IItem::List& children) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = children_.find(parent);
+  if (it != children_.end()) {
+    auto previous = it->second;
+    for (const auto& item : children) previous.erase(item->id());
+    for (const auto& id : previous) erase_tree(id);
+  }
+  for (const auto& item : children) insert(parent, item);
+}
+
+void SearchIndex::replace(const std::string& id, const IItem::Pointer& item) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  relocate(id, "", item);
+}
+
+void SearchIndex::move(const std::string& id, const std::string& parent,
+                       const IItem::Pointer& item) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  relocate(id, parent, item);
+}
+
+void SearchIndex::remove(const std::string& id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  erase_tree(id);
+}
+
+void SearchIndex::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  children_.clear();
+  trigrams_.clear();
+}
+
+IItem::List SearchIndex::search(const std::string& query, size_t limit) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto needle = util::to_lower(query);
+  auto name = needle.substr(needle.find_last_of('/') + 1);
+  std::vector<const Entry*> candidates;
+  if (name.length() < 3) {
+    for (const auto& d : entries_) candidates.push_back(&d.second);
+  } else {
+    const std::unordered_set<const Entry*>* smallest = nullptr;
+    for (auto trigram : trigrams(name)) {
+      auto it = trigrams_.find(trigram);
+      if (it == trigrams_.end()) return {};
+      if (!smallest || it->second.size() < smallest->size())
+        smallest = &it->second;
+    }
+    candidates.assign(smallest->begin(), smallest->end());
+  }
+  std::vector<std::pair<int, const Entry*>> matches;
+  for (auto entry : candidates) {
+    auto position = entry->name_.find(name);
+    if (position == std::string::npos) continue;
+    if (name.length() != needle.length() &&
+        util::to_lower(path(*entry)).find(needle) == std::string::npos)
+      continue;
+    matches.push_back({rank(entry->name_, name, position), entry});
+  }
+  auto count = std::min(limit, matches.size());
+  std::partial_sort(
+      matches.begin(), matches.begin() + count, matches.end(),
+      [](const std::pair<int, const Entry*>& e1,
+         const std::pair<int, const Entry*>& e2) {
+        if (e1.first != e2.first) return e1.first < e2.first;
+        const auto& n1 = e1.second->name_;
+        const auto& n2 = e2.second->name_;
+        if (n1.length() != n2.length()) return n1.length() < n2.length();
+        return n1 < n2;
+      });
+  IItem::List result;
+  for (size_t i = 0; i < count; i++) result.push_back(matches[i].second->item_);
+  return result;
+}
+
+std::string SearchIndex::path(const std::string& id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it == entries_.end()) return "";
+  return path(it->second);
+}
+
+size_t SearchIndex::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void SearchIndex::dump(std::ostream& stream) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Json::Value items(Json::arrayValue);
+  for (const auto& d : entries_) {
+    Json::Value item;
+    item["parent"] = d.second.parent_;
+    item["item"] = d.second.item_->toString();
+    items.append(item);
+  }
+  Json::Value json;
+  json["items"] = items;
+  stream << util::json::to_string(json);
+}
+
+bool SearchIndex::load(std::istream& stream) {
+  try {
+    auto json = util::json::from_stream(stream);
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    children_.clear();
+    trigrams_.clear();
+    for (const auto& d : json["items"])
+      insert(d["parent"].asString(), IItem::fromString(d["item"].asString()));
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+void SearchIndex::insert(std::string parent, const IItem::Pointer& item) {
+  auto it = entries_.find(item->id());
+  if (it != entries_.end()) {
+    if (parent.empty()) parent = it->second.parent_;
+    erase(it);
+  }
+  auto& entry = entries_[item->id()];
+  entry.parent_ = parent;
+  entry.name_ = util::to_lower(item->filename());
+  entry.item_ = item;
+  for (auto trigram : trigrams(entry.name_)) trigrams_[trigram].insert(&entry);
+  children_[parent].insert(item->id());
+}
+
+void SearchIndex::erase(EntryMap::iterator it) {
+  const auto& entry = it->second;
+  for (auto trigram : trigrams(entry.name_)) {
+    auto posting = trigrams_.find(trigram);
+    if (posting == trigrams_.end()) continue;
+    posting->second.erase(&entry);
+    if (posting->second.empty()) trigrams_.erase(posting);
+  }
+  auto children = children_.find(entry.parent_);
+  if (children != children_.end()) {
+    children->second.erase(it->first);
+    if (children->second.empty()) children_.erase(children);
+  }
+  entries_.erase(it);
+}
+
+void SearchIndex::erase_tree(const std::string& id) {
+  std::vector<std::string> pending = {id};
+  while (!pending.empty()) {
+    auto current = std::move(pending.back());
+    pending.pop_back();
+    auto children = children_.find(current);
+    if (children != children_.end())
+      pending.insert(pending.end(), children->second.begin(),
+                     children->second.end());
+    auto it = entries_.find(current);
+    if (it != entries_.end()) erase(it);
+  }
+}
+
+void SearchIndex::relocate(const std::string& id, std::string parent,
+                           const IItem::Pointer& item) {
+  auto it = entries_.find(id);
+  if (it != entries_.end()) {
+    if (parent.empty()) parent = it->second.parent_;
+    if (item->id() != id)
+      erase_tree(id);
+    else
+      erase(it);
+  }
+  insert(parent, item);
+}
+
+std::string SearchIndex::path(const Entry& entry) const {
+  std::string result = "/" + entry.item_->filename();
+  auto current = &entry;
+  for (int i = 0; i < MAX_PATH_DEPTH && !current->parent_.empty(); i++) {
+    auto it = entries_.find(current->parent_);
+    if (it == entries_.end()) break;
+    current = &it->second;
+    result = "/" + current->item_->filename() + result;
+  }
+  return result;
+}
+
+}  // namespace cloudstorage
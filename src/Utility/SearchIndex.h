@@ -0,0 +1,125 @@
+/*****************************************************************************
+ * SearchIndex.h
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "IItem.h"
+
+namespace cloudstorage {
+
+/**
+ * In-memory index of filenames of items seen by a cloud provider. Names are
+ * broken into trigrams, so substring queries only look at items which contain
+ * all of the query's trigrams.
+ */
+class SearchIndex {
+ public:
+  using Pointer = std::shared_ptr<SearchIndex>;
+
+  static constexpr size_t DEFAULT_LIMIT = 100;
+
+  /**
+   * Adds or updates item; if parent is empty, previously known parent is
+   * kept.
+   */
+  void add(const std::string& parent, const IItem::Pointer& item);
+
+  /**
+   * Replaces known children of the directory with the listing; children
+   * missing from it are removed together with everything below them.
+   */
+  void update(const std::string& parent, const IItem::List& children);
+
+  /**
+   * Replaces item with the given id, keeping its parent. If the new item has
+   * a different id, everything known below the old one is removed.
+   */
+  void replace(const std::string& id, const IItem::Pointer& item);
+
+  /**
+   * Moves item with the given id under parent, like replace.
+   */
+  void move(const std::string& id, const std::string& parent,
+            const IItem::Pointer& item);
+
+  /**
+   * Removes the item and everything known below it.
+   */
+  void remove(const std::string& id);
+  void clear();
+
+  /**
+   * Finds items whose filename contains the query, case insensitive. If the
+   * query contains '/', its last component is matched against the filename
+   * and the whole query against the item's path.
+   *
+   * @return items ordered by relevance: exact matches, prefix matches, matches
+   * at word boundary and then any other matches
+   */
+  IItem::List search(const std::string& query,
+                     size_t limit = DEFAULT_LIMIT) const;
+
+  /**
+   * @return path of the item built from the parents known to the index
+   */
+  std::string path(const std::string& id) const;
+
+  size_t size() const;
+
+  void dump(std::ostream&) const;
+
+  /**
+   * Replaces contents of the index with the ones written by dump.
+   */
+  bool load(std::istream&);
+
+ private:
+  struct Entry {
+    std::string parent_;
+    std::string name_;
+    IItem::Pointer item_;
+  };
+
+  using EntryMap = std::unordered_map<std::string, Entry>;
+
+  void insert(std::string parent, const IItem::Pointer& item);
+  void erase(EntryMap::iterator);
+  void erase_tree(const std::string& id);
+  void relocate(const std::string& id, std::string parent,
+                const IItem::Pointer& item);
+  std::string path(const Entry&) const;
+
+  mutable std::mutex mutex_;
+  EntryMap entries_;
+  std::unordered_map<std::string, std::unordered_set<std::string>> children_;
+  std::unordered_map<uint32_t, std::unordered_set<const Entry*>> trigrams_;
+};
+
+}  // namespace cloudstorage
+
+#endif  // SEARCHINDEX_H
@@ -24,14 +24,20 @@
 #ifndef UTILITY_H
 #define UTILITY_H
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <codecvt>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -204,6 +210,14 @@ constexpr auto RESOLVER_NOT_SET = "resolver not set";
 constexpr auto COULD_NOT_START_HTTP_SERVER = "couldn't start http server";
 constexpr auto INVALID_RADIX_BASE = "invalid radix base";
 constexpr auto UNIMPLEMENTED = "unimplemented";
+constexpr auto INVALID_CURSOR = "invalid cursor";
+constexpr auto INVALID_UPLOAD_SESSION = "invalid upload session";
+constexpr auto CONTENT_HASH_MISMATCH = "content hash mismatch";
+constexpr auto INCOMPLETE_SEGMENT = "incomplete segment";
+constexpr auto COULD_NOT_WRITE_FILE = "couldn't write file";
+constexpr auto BUFFER_OVERFLOW = "buffer overflow";
+constexpr auto UPLOAD_DATA_UNAVAILABLE =
+    "upload data at requested offset is unavailable";
 
 }  // namespace Error
 
@@ -260,55 +274,136 @@ void log(Args&&... t) {
 #endif
 }
 
+/**
+ * Least recently used cache, split into shards guarded by separate locks so
+ * that concurrent users rarely wait for each other. Capacity is measured with
+ * the size function, which counts every entry as one unless given; each
+ * shard holds an equal part of it, but always room for at least one entry.
+ */
 template <class Key, class Value>
 class LRUCache {
  public:
-  LRUCache(size_t size) : size_(size), time_() {}
+  using SizeFunction = std::function<size_t(const Value&)>;
+  using Clock = std::chrono::steady_clock;
+
+  LRUCache(size_t capacity, SizeFunction size = nullptr, size_t shards = 1)
+      : size_(std::move(size)),
+        shard_count_(std::max<size_t>(shards, 1)),
+        shards_(new Shard[shard_count_]),
+        capacity_(capacity),
+        hits_(),
+        misses_() {}
 
   std::shared_ptr<Value> get(const Key& key) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    auto it = data_.find(key);
-    if (it == data_.end())
+    auto& shard = this->shard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    auto it = shard.index_.find(key);
+    if (it != shard.index_.end() && expired(*it->second)) {
+      shard.erase(it);
+      it = shard.index_.end();
+    }
+    if (it == shard.index_.end()) {
+      misses_++;
       return nullptr;
-    else {
-      mark(key, time_);
-      time_++;
-      return it->second.first;
     }
+    shard.entries_.splice(shard.entries_.begin(), shard.entries_, it->second);
+    hits_++;
+    return it->second->value_;
+  }
+
+  /**
+   * Stores value under key, replacing the previous one; ttl of zero keeps the
+   * entry until it's evicted.
+   */
+  void put(const Key& key, const std::shared_ptr<Value>& value,
+           std::chrono::milliseconds ttl = std::chrono::milliseconds::zero()) {
+    auto& shard = this->shard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    auto it = shard.index_.find(key);
+    if (it != shard.index_.end()) shard.erase(it);
+    auto size = size_ ? size_(*value) : 1;
+    shard.entries_.push_front(
+        {key, value, size,
+         ttl.count() > 0 ? Clock::now() + ttl : Clock::time_point()});
+    shard.index_[key] = shard.entries_.begin();
+    shard.size_ += size;
+    shard.evict(shard_capacity());
+  }
+
+  void erase(const Key& key) {
+    auto& shard = this->shard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    auto it = shard.index_.find(key);
+    if (it != shard.index_.end()) shard.erase(it);
   }
 
-  void put(const Key& key, const std::shared_ptr<Value>& value) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    auto data_it = data_.find(key);
-    if (data_it != data_.end()) {
-      mark(key, time_);
-      time_++;
-      return;
+  size_t capacity() const { return capacity_; }
+
+  void set_capacity(size_t capacity) {
+    capacity_ = capacity;
+    for (size_t i = 0; i < shard_count_; i++) {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex_);
+      shards_[i].evict(shard_capacity());
     }
-    data_[key] = {value, time_};
-    access_time_[time_++] = key;
-    if (data_.size() > size_) {
-      auto access_it = access_time_.begin();
-      auto data_it = data_.find(access_it->second);
-      access_time_.erase(access_it);
-      data_.erase(data_it);
+  }
+
+  size_t size() const {
+    size_t result = 0;
+    for (size_t i = 0; i < shard_count_; i++) {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex_);
+      result += shards_[i].size_;
     }
+    return result;
   }
 
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
  private:
-  void mark(const Key& key, uint32_t time) {
-    auto data_it = data_.find(key);
-    auto access_it = access_time_.find(data_it->second.second);
-    access_time_.erase(access_it);
-    data_it->second.second = time;
-    access_time_[time] = key;
+  struct Entry {
+    Key key_;
+    std::shared_ptr<Value> value_;
+    size_t size_;
+    Clock::time_point expires_;
+  };
+
+  struct Shard {
+    using Iterator = typename std::list<Entry>::iterator;
+
+    void erase(typename std::unordered_map<Key, Iterator>::iterator it) {
+      size_ -= it->second->size_;
+      entries_.erase(it->second);
+      index_.erase(it);
+    }
+
+    void evict(size_t capacity) {
+      while (size_ > capacity) erase(index_.find(entries_.back().key_));
+    }
+
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_;
+    std::unordered_map<Key, Iterator> index_;
+    size_t size_ = 0;
+  };
+
+  static bool expired(const Entry& e) {
+    return e.expires_ != Clock::time_point() && e.expires_ <= Clock::now();
+  }
+
+  Shard& shard(const Key& key) {
+    return shards_[std::hash<Key>()(key) % shard_count_];
+  }
+
+  size_t shard_capacity() const {
+    return std::max<size_t>(capacity_ / shard_count_, 1);
   }
 
-  std::mutex mutex_;
-  std::unordered_map<Key, std::pair<std::shared_ptr<Value>, uint32_t>> data_;
-  std::map<uint32_t, Key> access_time_;
-  size_t size_;
-  uint32_t time_;
+  SizeFunction size_;
+  size_t shard_count_;
+  std::unique_ptr<Shard[]> shards_;
+  std::atomic<size_t> capacity_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
 };
 
 }  // namespace util
@@ -0,0 +1,91 @@
+/*****************************************************************************
+ * ContentHashTest.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2016-2016 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#include "Utility/ContentHash.h"
+#include "gtest/gtest.h"
+
+using namespace cloudstorage;
+
+namespace {
+
+std::string digest(IItem::HashType type, const std::string& data,
+                   size_t step) {
+  auto hash = ContentHash::create(type);
+  for (size_t i = 0; i < data.size(); i += step)
+    hash->update(data.data() + i, std::min(step, data.size() - i));
+  return hash->digest();
+}
+
+// Bytes of a linear congruential generator; unlike a repeating pattern they
+// don't cancel out in QuickXorHash, so shift and wrap errors show up.
+std::string lcg_data() {
+  std::string result(5000011, 0);
+  uint32_t state = 1;
+  for (auto& c : result) {
+    state = state * 1103515245 + 12345;
+    c = static_cast<char>(state >> 16);
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(ContentHashTest, Empty) {
+  EXPECT_EQ(digest(IItem::HashType::MD5, "", 1),
+            "d41d8cd98f00b204e9800998ecf8427e");
+  EXPECT_EQ(digest(IItem::HashType::SHA1, "", 1),
+            "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+  EXPECT_EQ(digest(IItem::HashType::DropboxContentHash, "", 1),
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  EXPECT_EQ(digest(IItem::HashType::QuickXorHash, "", 1),
+            "AAAAAAAAAAAAAAAAAAAAAAAAAAA=");
+  EXPECT_EQ(ContentHash::create(IItem::HashType::None), nullptr);
+}
+
+TEST(ContentHashTest, Short) {
+  for (size_t step : {1, 2, 3}) {
+    EXPECT_EQ(digest(IItem::HashType::MD5, "abc", step),
+              "900150983cd24fb0d6963f7d28e17f72");
+    EXPECT_EQ(digest(IItem::HashType::SHA1, "abc", step),
+              "a9993e364706816aba3e25717850c26c9cd0d89d");
+    EXPECT_EQ(
+        digest(IItem::HashType::DropboxContentHash, "abc", step),
+        "4f8b42c22dd3729b519ba6f68d2da7cc5b2d606d05daed5ad5128cc03e6c6358");
+    EXPECT_EQ(digest(IItem::HashType::QuickXorHash, "abc", step),
+              "YRDDGAAAAAAAAAAAAwAAAAAAAAA=");
+  }
+}
+
+TEST(ContentHashTest, MultipleBlocks) {
+  auto data = lcg_data();
+  for (size_t step : {size_t(333), size_t(65536), data.size()}) {
+    EXPECT_EQ(digest(IItem::HashType::MD5, data, step),
+              "09015a79651be9c38b30b14873988a73");
+    EXPECT_EQ(digest(IItem::HashType::SHA1, data, step),
+              "8df0fc27928e4f99f32485dae7706fd136898dda");
+    EXPECT_EQ(
+        digest(IItem::HashType::DropboxContentHash, data, step),
+        "1753a9d3caeb5cbad9696a33b19212e3c5e70e2703b30b6cf66f5ee252601295");
+    EXPECT_EQ(digest(IItem::HashType::QuickXorHash, data, step),
+              "1OvcuuyBH2KXpxBZjOxe2T66+3U=");
+  }
+}
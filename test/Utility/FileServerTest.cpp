@@ -0,0 +1,110 @@
+/*****************************************************************************
+ * FileServerTest.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#include "Utility/FileServer.h"
+#include "gtest/gtest.h"
+
+#include <json/json.h>
+
+using namespace cloudstorage;
+
+namespace {
+
+using Ranges = std::vector<std::pair<uint64_t, uint64_t>>;
+const Ranges Ignored = {{-1ull, 0}};
+
+Ranges ranges(const std::string& header, uint64_t size) {
+  std::vector<Range> ranges;
+  if (!FileServer::parse_ranges(header, size, ranges)) return Ignored;
+  Ranges result;
+  for (auto range : ranges) result.push_back({range.start_, range.size_});
+  return result;
+}
+
+Json::Value file(const std::string& hash, int64_t timestamp) {
+  Json::Value json;
+  json["id"] = "id";
+  json["size"] = Json::Int64(1000);
+  if (!hash.empty()) json["hash"] = hash;
+  if (timestamp != 0) json["timestamp"] = Json::Int64(timestamp);
+  return json;
+}
+
+}  // namespace
+
+TEST(FileServerTest, ParsesRanges) {
+  EXPECT_EQ(ranges("bytes=0-99", 1000), Ranges({{0, 100}}));
+  EXPECT_EQ(ranges("bytes=500-", 1000), Ranges({{500, 500}}));
+  EXPECT_EQ(ranges("bytes = 0-0, 10-19", 1000), Ranges({{0, 1}, {10, 10}}));
+}
+
+TEST(FileServerTest, ParsesSuffixRanges) {
+  EXPECT_EQ(ranges("bytes=-100", 1000), Ranges({{900, 100}}));
+  EXPECT_EQ(ranges("bytes=-2000", 1000), Ranges({{0, 1000}}));
+  EXPECT_EQ(ranges("bytes=-0", 1000), Ranges());
+}
+
+TEST(FileServerTest, ClipsRanges) {
+  EXPECT_EQ(ranges("bytes=900-2000", 1000), Ranges({{900, 100}}));
+  EXPECT_EQ(ranges("bytes=0-9,1000-2000", 1000), Ranges({{0, 10}}));
+  // Nothing satisfiable, answered with 416.
+  EXPECT_EQ(ranges("bytes=1000-2000", 1000), Ranges());
+}
+
+TEST(FileServerTest, IgnoresInvalidRanges) {
+  EXPECT_EQ(ranges("items=0-99", 1000), Ignored);
+  EXPECT_EQ(ranges("bytes=99-0", 1000), Ignored);
+  EXPECT_EQ(ranges("bytes=-", 1000), Ignored);
+  EXPECT_EQ(ranges("bytes=10", 1000), Ignored);
+  EXPECT_EQ(ranges("bytes=a-b", 1000), Ignored);
+  EXPECT_EQ(ranges("bytes=0-99999999999999999999999", 1000), Ignored);
+}
+
+TEST(FileServerTest, LimitsRangeCount) {
+  std::string header = "bytes=0-0";
+  for (int i = 1; i < 32; i++)
+    header += "," + std::to_string(i) + "-" + std::to_string(i);
+  EXPECT_EQ(ranges(header, 1000).size(), 32u);
+  EXPECT_EQ(ranges(header + ",32-32", 1000), Ignored);
+}
+
+TEST(FileServerTest, EntityTagFollowsVersion) {
+  EXPECT_EQ(FileServer::entity_tag(file("", 0)), "");
+  auto tag = FileServer::entity_tag(file("hash", 0));
+  EXPECT_EQ(tag.front(), '"');
+  EXPECT_EQ(tag.back(), '"');
+  EXPECT_EQ(tag, FileServer::entity_tag(file("hash", 0)));
+  EXPECT_NE(tag, FileServer::entity_tag(file("other", 0)));
+  EXPECT_NE(FileServer::entity_tag(file("", 1)),
+            FileServer::entity_tag(file("", 2)));
+  auto resized = file("hash", 0);
+  resized["size"] = Json::Int64(1001);
+  EXPECT_NE(tag, FileServer::entity_tag(resized));
+}
+
+TEST(FileServerTest, MatchesTagList) {
+  EXPECT_TRUE(FileServer::matches_tag("\"a\"", "\"a\""));
+  EXPECT_TRUE(FileServer::matches_tag("\"b\", W/\"a\"", "\"a\""));
+  EXPECT_TRUE(FileServer::matches_tag("*", "\"a\""));
+  EXPECT_FALSE(FileServer::matches_tag("\"b\", \"c\"", "\"a\""));
+  EXPECT_FALSE(FileServer::matches_tag("*", ""));
+}
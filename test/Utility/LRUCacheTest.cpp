@@ -0,0 +1,84 @@
+/*****************************************************************************
+ * LRUCacheTest.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#include "Utility/Utility.h"
+#include "gtest/gtest.h"
+
+#include <thread>
+
+using namespace cloudstorage;
+
+using Cache = util::LRUCache<std::string, std::string>;
+
+TEST(LRUCacheTest, EvictsLeastRecentlyUsed) {
+  Cache cache(2);
+  cache.put("a", std::make_shared<std::string>("1"));
+  cache.put("b", std::make_shared<std::string>("2"));
+  EXPECT_NE(cache.get("a"), nullptr);
+  cache.put("c", std::make_shared<std::string>("3"));
+  EXPECT_EQ(cache.get("b"), nullptr);
+  EXPECT_EQ(*cache.get("a"), "1");
+  EXPECT_EQ(*cache.get("c"), "3");
+  EXPECT_EQ(cache.hits(), 3u);
+  EXPECT_EQ(cache.misses(), 1u);
+}
+
+TEST(LRUCacheTest, PutReplaces) {
+  Cache cache(2);
+  cache.put("a", std::make_shared<std::string>("1"));
+  cache.put("a", std::make_shared<std::string>("2"));
+  EXPECT_EQ(*cache.get("a"), "2");
+  cache.erase("a");
+  EXPECT_EQ(cache.get("a"), nullptr);
+}
+
+TEST(LRUCacheTest, SizeBudget) {
+  Cache cache(8, [](const std::string& d) { return d.size(); });
+  cache.put("a", std::make_shared<std::string>("1234"));
+  cache.put("b", std::make_shared<std::string>("5678"));
+  EXPECT_NE(cache.get("a"), nullptr);
+  cache.put("c", std::make_shared<std::string>("9"));
+  EXPECT_EQ(cache.get("b"), nullptr);
+  EXPECT_NE(cache.get("a"), nullptr);
+  EXPECT_NE(cache.get("c"), nullptr);
+  cache.set_capacity(1);
+  EXPECT_EQ(cache.get("a"), nullptr);
+  EXPECT_NE(cache.get("c"), nullptr);
+}
+
+TEST(LRUCacheTest, Expires) {
+  Cache cache(2);
+  cache.put("a", std::make_shared<std::string>("1"),
+            std::chrono::milliseconds(10));
+  EXPECT_NE(cache.get("a"), nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(cache.get("a"), nullptr);
+}
+
+TEST(LRUCacheTest, SmallCapacityWithShards) {
+  Cache cache(2, nullptr, 4);
+  cache.put("a", std::make_shared<std::string>("1"));
+  EXPECT_NE(cache.get("a"), nullptr);
+  cache.set_capacity(0);
+  cache.put("b", std::make_shared<std::string>("2"));
+  EXPECT_NE(cache.get("b"), nullptr);
+}
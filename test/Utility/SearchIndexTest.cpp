@@ -0,0 +1,126 @@
+/*****************************************************************************
+ * SearchIndexTest.cpp
+ *
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN
+ *
+ * Authors: Paweł Wegner <pawel.wegner95@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#include "Utility/SearchIndex.h"
+#include "Utility/Item.h"
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+using namespace cloudstorage;
+
+namespace {
+
+IItem::Pointer file(const std::string& id, const std::string& name) {
+  return std::make_shared<Item>(name, id, 0, IItem::UnknownTimeStamp,
+                                IItem::FileType::Unknown);
+}
+
+IItem::Pointer directory(const std::string& id, const std::string& name) {
+  return std::make_shared<Item>(name, id, 0, IItem::UnknownTimeStamp,
+                                IItem::FileType::Directory);
+}
+
+std::vector<std::string> ids(const IItem::List& list) {
+  std::vector<std::string> result;
+  for (const auto& d : list) result.push_back(d->id());
+  return result;
+}
+
+}  // namespace
+
+TEST(SearchIndexTest, RanksMatches) {
+  SearchIndex index;
+  index.add("root", file("1", "my holiday.mp4"));
+  index.add("root", file("2", "holiday.mp4"));
+  index.add("root", file("3", "holidays 2018.mp4"));
+  index.add("root", file("4", "theholiday.mp4"));
+  index.add("root", file("5", "work.doc"));
+  EXPECT_EQ(ids(index.search("HOLIDAY.mp4")),
+            std::vector<std::string>({"2", "1", "4"}));
+  EXPECT_EQ(ids(index.search("holiday")),
+            std::vector<std::string>({"2", "3", "1", "4"}));
+  EXPECT_EQ(ids(index.search("holiday", 1)), std::vector<std::string>({"2"}));
+  EXPECT_TRUE(index.search("nothing").empty());
+}
+
+TEST(SearchIndexTest, MatchesPath) {
+  SearchIndex index;
+  index.add("", directory("music", "Music"));
+  index.add("", directory("videos", "Videos"));
+  index.add("music", file("1", "song.mp3"));
+  index.add("videos", file("2", "song.mp3"));
+  EXPECT_EQ(index.path("1"), "/Music/song.mp3");
+  EXPECT_EQ(ids(index.search("music/song")), std::vector<std::string>({"1"}));
+}
+
+TEST(SearchIndexTest, UpdateDropsMissingChildren) {
+  SearchIndex index;
+  index.update("root", {directory("dir", "directory"), file("1", "first")});
+  index.add("dir", file("2", "nested"));
+  index.update("root", {file("1", "renamed")});
+  EXPECT_TRUE(index.search("first").empty());
+  EXPECT_EQ(ids(index.search("renamed")), std::vector<std::string>({"1"}));
+  EXPECT_TRUE(index.search("nested").empty());
+  EXPECT_EQ(index.size(), 1u);
+}
+
+TEST(SearchIndexTest, RemoveDropsSubtree) {
+  SearchIndex index;
+  index.add("", directory("a", "a"));
+  index.add("a", directory("b", "b"));
+  index.add("b", file("c", "nested file"));
+  index.add("", file("d", "other file"));
+  index.remove("a");
+  EXPECT_EQ(ids(index.search("file")), std::vector<std::string>({"d"}));
+  EXPECT_EQ(index.size(), 1u);
+}
+
+TEST(SearchIndexTest, MoveKeepsChildrenWhenIdIsKept) {
+  SearchIndex index;
+  index.add("", directory("a", "a"));
+  index.add("", directory("target", "target"));
+  index.add("a", file("c", "nested file"));
+  index.move("a", "target", directory("a", "a"));
+  EXPECT_EQ(index.path("c"), "/target/a/nested file");
+}
+
+TEST(SearchIndexTest, MoveDropsChildrenWhenIdChanges) {
+  SearchIndex index;
+  index.add("/", directory("/a", "a"));
+  index.add("/a", file("/a/c", "nested file"));
+  index.move("/a", "/target", directory("/target/a", "a"));
+  EXPECT_TRUE(index.search("nested").empty());
+  EXPECT_EQ(index.path("/target/a"), "/a");
+}
+
+TEST(SearchIndexTest, LoadReplacesContents) {
+  SearchIndex index;
+  index.add("root", file("1", "saved"));
+  std::stringstream stream;
+  index.dump(stream);
+  index.remove("1");
+  index.add("root", file("2", "unsaved"));
+  EXPECT_TRUE(index.load(stream));
+  EXPECT_EQ(ids(index.search("saved")), std::vector<std::string>({"1"}));
+  EXPECT_EQ(index.size(), 1u);
+}